@@ -0,0 +1,879 @@
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sources/MagicalContainer.hpp"
+#include "sources/ConcurrentMagicalContainer.hpp"
+#include "sources/ThreadPool.hpp"
+using namespace ariel;
+
+// run a function once and return the elapsed time in seconds
+static double timeIt(const std::function<void()> &function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// n distinct values in random order
+static std::vector<int> randomValues(std::size_t n)
+{
+    std::vector<int> values(n);
+    for (std::size_t i = 0; i < n; ++i) values[i] = static_cast<int>(i);
+    std::shuffle(values.begin(), values.end(), std::mt19937(42));
+    return values;
+}
+
+// print one result line: name, size, seconds and elements per second
+static void report(const std::string &name, std::size_t n, double seconds)
+{
+    std::cout << name << " n=" << n << " time=" << seconds << "s rate=" << static_cast<double>(n) / seconds << "/s" << std::endl;
+}
+
+// the sorted insertion used before: push back then bubble the element down with checked swaps
+static void legacySortedInsert(std::vector<int> &sorted, int element)
+{
+    sorted.push_back(element);
+    for (std::size_t i = sorted.size()-1; i>0; --i)
+    {
+        if(sorted.at(i-1) > sorted.at(i)) std::swap(sorted.at(i-1), sorted.at(i));
+    }
+}
+
+// the sorted insertion used by MagicalContainer: binary search then a single shift
+static void sortedInsert(std::vector<int> &sorted, int element)
+{
+    sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), element), element);
+}
+
+// sorted storage insert throughput, legacy bubble insert vs binary searched insert
+static void benchSortedInsert()
+{
+    const std::size_t legacy_limit = 100000; // quadratic path, larger sizes take hours
+    const std::size_t random_limit = 1000000; // random order still shifts half the tail on every insert
+    for (std::size_t n : {10000UL, 100000UL, 1000000UL, 10000000UL})
+    {
+        std::vector<int> random = randomValues(n);
+        std::vector<int> ascending = random;
+        std::sort(ascending.begin(), ascending.end());
+
+        for (const auto &[order, values] : {std::pair{"random", &random}, std::pair{"ascending", &ascending}})
+        {
+            std::string suffix = std::string(" ") + order;
+            if (n <= legacy_limit)
+            {
+                std::vector<int> sorted;
+                report("legacy-insert" + suffix, n, timeIt([&] { for (int value : *values) legacySortedInsert(sorted, value); }));
+            }
+            if (n <= random_limit || values == &ascending)
+            {
+                std::vector<int> sorted;
+                report("sorted-insert" + suffix, n, timeIt([&] { for (int value : *values) sortedInsert(sorted, value); }));
+            }
+        }
+    }
+}
+
+// MagicalContainer::addElement throughput, sorted store plus prime view maintenance
+static void benchAddElement()
+{
+    for (std::size_t n : {10000UL, 100000UL, 1000000UL})
+    {
+        std::vector<int> random = randomValues(n);
+        std::vector<int> ascending = random;
+        std::sort(ascending.begin(), ascending.end());
+
+        if (n <= 100000)
+        {
+            MagicalContainer container;
+            report("add-element random", n, timeIt([&] { for (int value : random) container.addElement(value); }));
+        }
+        MagicalContainer container;
+        report("add-element ascending", n, timeIt([&] { for (int value : ascending) container.addElement(value); }));
+    }
+}
+
+// random order ingest of 10K to 10M elements through every route: one addElement per element (the tail shift makes it
+// quadratic, so it stops at 100K), one addElements batch, addElements in batches of 10K as a feed arrives, build, and
+// staging with a merge every 64K elements
+static void benchIngest()
+{
+    for (std::size_t n : {10000UL, 100000UL, 1000000UL, 10000000UL})
+    {
+        std::vector<int> values = randomValues(n);
+        if (n <= 100000)
+        {
+            MagicalContainer container;
+            report("ingest add-element", n, timeIt([&] { for (int value : values) container.addElement(value); }));
+        }
+        {
+            MagicalContainer container;
+            report("ingest add-elements", n, timeIt([&] { container.addElements(values); }));
+        }
+        if (n <= 1000000)
+        {
+            MagicalContainer container;
+            const std::size_t batch = 10000;
+            report("ingest add-elements batch=10000", n, timeIt([&] {
+                for (std::size_t first = 0; first < n; first += batch)
+                {
+                    container.addElements(std::span<const int>(values).subspan(first, std::min(batch, n - first)));
+                }
+            }));
+        }
+        {
+            MagicalContainer container;
+            report("ingest build", n, timeIt([&] { container.build(values); }));
+        }
+        {
+            MagicalContainer container;
+            container.reserveStaging(1U << 16U);
+            report("ingest stage", n, timeIt([&] {
+                for (int value : values)
+                {
+                    if (!container.stageElement(value))
+                    {
+                        container.mergeStaged();
+                        container.stageElement(value);
+                    }
+                }
+                container.mergeStaged();
+            }));
+        }
+    }
+}
+
+// MagicalContainer copy constructor cost
+static void benchCopy()
+{
+    for (std::size_t n : {100000UL, 1000000UL, 10000000UL})
+    {
+        std::vector<int> ascending = randomValues(n);
+        std::sort(ascending.begin(), ascending.end());
+        MagicalContainer container;
+        for (int value : ascending) container.addElement(value);
+
+        const int copies = 10;
+        report("copy", n, timeIt([&] {
+            for (int i = 0; i < copies; ++i)
+            {
+                MagicalContainer copy(container);
+                if (copy.size() != container.size()) std::cout << "copy size mismatch" << std::endl;
+            }
+        }) / copies);
+    }
+}
+
+// MagicalContainer::removeElement throughput
+static void benchRemoveElement()
+{
+    for (std::size_t n : {10000UL, 100000UL, 1000000UL})
+    {
+        std::vector<int> random = randomValues(n);
+        std::vector<int> descending = random;
+        std::sort(descending.rbegin(), descending.rend());
+
+        MagicalContainer container;
+        for (auto value = descending.rbegin(); value != descending.rend(); ++value) container.addElement(*value); // append in ascending order
+        if (n <= 100000)
+        {
+            MagicalContainer copy(container);
+            report("remove-element random", n, timeIt([&] { for (int value : random) copy.removeElement(value); }));
+        }
+        report("remove-element descending", n, timeIt([&] { for (int value : descending) container.removeElement(value); }));
+    }
+}
+
+// MagicalContainer::addElements throughput for one unsorted batch
+static void benchAddElements()
+{
+    for (std::size_t n : {1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL})
+    {
+        std::vector<int> random = randomValues(n);
+        MagicalContainer container;
+        report("add-elements batch", n, timeIt([&] { container.addElements(random); }));
+    }
+}
+
+// MagicalContainer::removeElements throughput for a fraction of a large container
+static void benchRemoveElements()
+{
+    const std::size_t n = 10000000;
+    MagicalContainer container;
+    container.addElements(randomValues(n));
+    for (std::size_t percent : {10UL, 50UL, 90UL})
+    {
+        MagicalContainer copy(container);
+        std::vector<int> victims = randomValues(n);
+        victims.resize(n * percent / 100);
+        report("remove-elements " + std::to_string(percent) + "%", victims.size(), timeIt([&] { copy.removeElements(victims); }));
+    }
+}
+
+// resident set size of this process in bytes
+static std::size_t residentBytes()
+{
+    std::size_t pages = 0;
+    std::size_t resident = 0;
+    std::ifstream("/proc/self/statm") >> pages >> resident;
+    return resident * 4096;
+}
+
+// resident memory per element of a container filled by fill
+template <class Fill>
+static void benchMemoryRun(const std::string &name, std::size_t n, Fill fill)
+{
+    std::size_t before = residentBytes();
+    MagicalContainer container;
+    fill(container);
+    std::size_t after = residentBytes();
+    std::cout << "memory " << name << " n=" << n << " rss=" << (after - before) / (1024 * 1024) << "MiB bytes/element="
+              << static_cast<double>(after - before) / static_cast<double>(n) << std::endl;
+}
+
+// resident memory per element of a large container, filled in one batch and through the incremental paths
+static void benchMemory()
+{
+    const std::size_t n = 10000000;
+    std::vector<int> values = randomValues(n);
+    benchMemoryRun("one batch", n, [&](MagicalContainer &container) { container.addElements(values); });
+    std::vector<int> ascending(n);
+    std::iota(ascending.begin(), ascending.end(), 0);
+    benchMemoryRun("1K sorted batches", n, [&](MagicalContainer &container) {
+        for (std::size_t first = 0; first < n; first += 1000) container.addElements(std::span<const int>(ascending).subspan(first, std::min<std::size_t>(1000, n - first)));
+    });
+    benchMemoryRun("add-element sorted", n, [&](MagicalContainer &container) {
+        for (int value : ascending) container.addElement(value);
+    });
+    benchMemoryRun("add-element sorted after publish", n, [&](MagicalContainer &container) {
+        container.publish();
+        for (int value : ascending) container.addElement(value);
+    });
+}
+
+// resident memory of a repetitive feed, every value added ten times
+template <Duplicates Policy>
+static void benchRepetitiveMemory(const std::string &name)
+{
+    const std::size_t n = 10000000;
+    std::vector<int> values = randomValues(n);
+    for (int &value : values) value /= 10;
+    std::size_t before = residentBytes();
+    BasicMagicalContainer<Policy> container;
+    container.addElements(values);
+    std::size_t after = residentBytes();
+    std::cout << "memory " << name << " n=" << container.totalCount() << " stored=" << container.size() << " rss="
+              << (after - before) / (1024 * 1024) << "MiB" << std::endl;
+}
+
+// full side cross traversal through the iterator
+static void benchCrossTraversal()
+{
+    const std::size_t n = 10000000;
+    MagicalContainer container;
+    container.addElements(randomValues(n));
+    MagicalContainer::SideCrossIterator cross_itr(container);
+
+    long long sum = 0;
+    report("cross-traversal iterator", n, timeIt([&] { for (auto itr = cross_itr.begin(); itr != cross_itr.end(); ++itr) sum += *itr; }));
+    std::vector<int> buffer(4096);
+    report("cross-traversal emit-pairs", n, timeIt([&] {
+        auto itr = cross_itr.begin();
+        for (std::size_t written = 0; (written = itr.emitPairs(buffer)) > 0;)
+        {
+            for (std::size_t i = 0; i < written; ++i) sum += buffer[i];
+        }
+    }));
+    std::cout << "checksum " << sum << std::endl;
+}
+
+// std::lower_bound through AscendingIterator against the same search on the raw vector
+static void benchLowerBound()
+{
+    const std::size_t n = 10000000;
+    const std::size_t queries = 1000000;
+    MagicalContainer container;
+    container.addElements(randomValues(n));
+    std::vector<int> raw(container.ascView().begin(), container.ascView().end());
+    std::vector<int> keys = randomValues(queries);
+    MagicalContainer::AscendingIterator asc_itr(container);
+
+    long long found = 0;
+    report("lower-bound iterator", queries, timeIt([&] {
+        auto begin = asc_itr.begin();
+        auto end = asc_itr.end();
+        for (int key : keys) found += *std::lower_bound(begin, end, key);
+    }));
+    report("lower-bound vector", queries, timeIt([&] { for (int key : keys) found += *std::lower_bound(raw.begin(), raw.end(), key); }));
+    std::cout << "checksum " << found << std::endl;
+}
+
+// full ascending sum: range-for over the container (sentinel end) vs the iterator end() loop vs the raw vector
+static void benchSentinel()
+{
+    const std::size_t n = 10000000;
+    const int rounds = 10;
+    MagicalContainer container;
+    container.addElements(randomValues(n));
+    std::vector<int> raw(container.ascView().begin(), container.ascView().end());
+    MagicalContainer::AscendingIterator asc_itr(container);
+
+    long long sum = 0;
+    report("ascending-sum vector", n * rounds, timeIt([&] { for (int round = 0; round < rounds; ++round) for (int element : raw) sum += element; }));
+    report("ascending-sum sentinel", n * rounds, timeIt([&] { for (int round = 0; round < rounds; ++round) for (int element : container) sum += element; }));
+    report("ascending-sum iterator", n * rounds, timeIt([&] {
+        for (int round = 0; round < rounds; ++round)
+        {
+            for (auto itr = asc_itr.begin(); itr != asc_itr.end(); ++itr) sum += *itr;
+        }
+    }));
+    std::cout << "checksum " << sum << std::endl;
+}
+
+// iterator assignment in a tight loop on a large container, the same container check is one address compare
+static void benchAssignment()
+{
+    const std::size_t n = 10000000;
+    const std::size_t assignments = 10000000;
+    MagicalContainer container;
+    container.addElements(randomValues(n));
+    MagicalContainer::AscendingIterator asc_itr(container);
+    MagicalContainer::SideCrossIterator cross_itr(container);
+    MagicalContainer::PrimeIterator prime_itr(container);
+    auto asc_end = asc_itr.end();
+    auto cross_end = cross_itr.end();
+    auto prime_end = prime_itr.end();
+
+    std::size_t ended = 0;
+    report("assignment ascending", assignments, timeIt([&] {
+        for (std::size_t i = 0; i < assignments; ++i)
+        {
+            asc_itr = (i & 1U) != 0 ? asc_end : asc_itr.begin();
+            if (asc_itr == asc_end) ++ended;
+        }
+    }));
+    report("assignment cross", assignments, timeIt([&] {
+        for (std::size_t i = 0; i < assignments; ++i)
+        {
+            cross_itr = (i & 1U) != 0 ? cross_end : cross_itr.begin();
+            if (cross_itr == cross_end) ++ended;
+        }
+    }));
+    report("assignment prime", assignments, timeIt([&] {
+        for (std::size_t i = 0; i < assignments; ++i)
+        {
+            prime_itr = (i & 1U) != 0 ? prime_end : prime_itr.begin();
+            if (prime_itr == prime_end) ++ended;
+        }
+    }));
+    std::cout << "checksum " << ended << std::endl;
+}
+
+// 100M element sums through every iterator, build with make bench and make bench-checked to compare the modes
+static void benchIteratorSum()
+{
+    const std::size_t n = 10000000;
+    const int rounds = 10;
+    MagicalContainer container;
+    container.addElements(randomValues(n));
+    MagicalContainer::SideCrossIterator cross_itr(container);
+    MagicalContainer::PrimeIterator prime_itr(container);
+
+    std::cout << (CHECKED_ITERATORS ? "checked" : "unchecked") << " iterators" << std::endl;
+    long long sum = 0;
+    report("iterator-sum ascending", n * rounds, timeIt([&] { for (int round = 0; round < rounds; ++round) for (int element : container) sum += element; }));
+    report("iterator-sum cross", n * rounds, timeIt([&] {
+        for (int round = 0; round < rounds; ++round)
+        {
+            for (auto itr = cross_itr.begin(); itr != MagicalContainer::SideCrossSentinel{}; ++itr) sum += *itr;
+        }
+    }));
+    report("iterator-sum prime", container.primeCount() * rounds, timeIt([&] {
+        for (int round = 0; round < rounds; ++round)
+        {
+            for (auto itr = prime_itr.begin(); itr != MagicalContainer::PrimeSentinel{}; ++itr) sum += *itr;
+        }
+    }));
+    std::cout << "checksum " << sum << std::endl;
+}
+
+// primes() | take(k) only visits k primes, its cost must not depend on the container size
+static void benchPrimesTake()
+{
+    const std::size_t k = 10;
+    const std::size_t repeats = 100000;
+    for (std::size_t n : {10000UL, 1000000UL, 10000000UL})
+    {
+        MagicalContainer container;
+        container.addElements(randomValues(n));
+        long long sum = 0;
+        double seconds = timeIt([&] {
+            for (std::size_t i = 0; i < repeats; ++i)
+            {
+                for (int prime : container.primes() | std::views::take(k)) sum += prime;
+            }
+        });
+        std::cout << "primes-take k=" << k << " n=" << n << " time per pipeline=" << seconds / static_cast<double>(repeats) * 1e9 << "ns checksum " << sum << std::endl;
+    }
+}
+
+// drain a full order through nextBatch with different batch sizes
+template <class Iterator>
+static void benchNextBatch(const std::string &name, Iterator begin, std::size_t n)
+{
+    long long sum = 0;
+    for (std::size_t batch : {1UL, 64UL, 256UL, 1024UL, 4096UL})
+    {
+        std::vector<int> buffer(batch);
+        report("next-batch " + name + " batch=" + std::to_string(batch), n, timeIt([&] {
+            Iterator itr = begin;
+            for (std::size_t written = 0; (written = itr.nextBatch(buffer)) > 0;)
+            {
+                for (std::size_t i = 0; i < written; ++i) sum += buffer[i];
+            }
+        }));
+    }
+    std::cout << "checksum " << sum << std::endl;
+}
+
+// batch fetch of every order against the element by element loop
+static void benchNextBatches()
+{
+    const std::size_t n = 10000000;
+    MagicalContainer container;
+    container.addElements(randomValues(n));
+
+    long long sum = 0;
+    report("next-batch ascending element", n, timeIt([&] { for (int element : container.ascending()) sum += element; }));
+    benchNextBatch("ascending", MagicalContainer::AscendingIterator(container), n);
+    report("next-batch cross element", n, timeIt([&] { for (int element : container.sideCross()) sum += element; }));
+    benchNextBatch("cross", MagicalContainer::SideCrossIterator(container), n);
+    report("next-batch prime element", container.primeCount(), timeIt([&] { for (int element : container.primes()) sum += element; }));
+    benchNextBatch("prime", MagicalContainer::PrimeIterator(container), container.primeCount());
+    std::cout << "checksum " << sum << std::endl;
+}
+
+// top k largest primes: copy and reverse the primes vs walking the prime view backwards
+static void benchTopK()
+{
+    const std::size_t n = 10000000;
+    const std::size_t k = 10;
+    const std::size_t queries = 100;
+    MagicalContainer container;
+    container.addElements(randomValues(n));
+
+    long long sum = 0;
+    report("top-k copy-reverse", queries, timeIt([&] {
+        for (std::size_t query = 0; query < queries; ++query)
+        {
+            std::vector<int> primes(container.primes().begin(), container.primes().begin().end());
+            std::reverse(primes.begin(), primes.end());
+            for (std::size_t i = 0; i < k; ++i) sum += primes[i];
+        }
+    }));
+    report("top-k reverse-view", queries, timeIt([&] {
+        for (std::size_t query = 0; query < queries; ++query)
+        {
+            for (int prime : container.primes().reversed() | std::views::take(k)) sum += prime;
+        }
+    }));
+    report("descending-sum", n, timeIt([&] { for (auto itr = container.rbegin(); itr != container.rend(); ++itr) sum += *itr; }));
+    std::cout << "checksum " << sum << std::endl;
+}
+
+// rank/select over the prime bits of 100M elements: memory against the element storage and query cost
+static void benchRankSelect()
+{
+    const std::size_t n = 100000000;
+    const std::size_t queries = 10000000;
+    std::vector<int> elements(n);
+    for (std::size_t i = 0; i < n; ++i) elements[i] = static_cast<int>(i);
+    std::vector<bool> flags;
+    PrimeSieve(static_cast<std::uint32_t>(n)).classify(elements, flags);
+
+    RankSelect bits;
+    double seconds = timeIt([&] {
+        bits.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) bits.pushBack(flags[i]);
+        bits.build();
+    });
+    report("rank-select build", n, seconds);
+    double element_bytes = static_cast<double>(n * sizeof(int));
+    double index_bytes = static_cast<double>(n * sizeof(std::uint8_t) + bits.ones() * sizeof(std::size_t));
+    std::cout << "rank-select n=" << n << " primes=" << bits.ones() << " bits and indexes=" << static_cast<double>(bits.memoryBytes()) / element_bytes * 100
+              << "% of elements, flags and index vector=" << index_bytes / element_bytes * 100 << "%" << std::endl;
+
+    std::mt19937 random(7);
+    std::uniform_int_distribution<std::size_t> position(0, n);
+    std::uniform_int_distribution<std::size_t> rank(0, bits.ones() - 1);
+    std::vector<std::size_t> positions(queries);
+    std::vector<std::size_t> ranks(queries);
+    for (std::size_t i = 0; i < queries; ++i)
+    {
+        positions[i] = position(random);
+        ranks[i] = rank(random);
+    }
+    std::size_t sum = 0;
+    report("rank-select rank", queries, timeIt([&] { for (std::size_t query : positions) sum += bits.rank(query); }));
+    report("rank-select select", queries, timeIt([&] { for (std::size_t query : ranks) sum += bits.select(query); }));
+    std::cout << "checksum " << sum << std::endl;
+}
+
+// primesBefore and prime iterator jumps on a container against counting with the iterator
+static void benchPrimeSeek()
+{
+    const std::size_t n = 10000000;
+    const std::size_t queries = 1000000;
+    MagicalContainer container;
+    container.addElements(randomValues(n));
+    std::vector<int> values = randomValues(queries);
+    for (int &value : values) value *= static_cast<int>(n / queries);
+
+    std::size_t sum = 0;
+    report("prime-seek primes-before", queries, timeIt([&] { for (int value : values) sum += container.primesBefore(value); }));
+    auto begin = container.primes().begin();
+    report("prime-seek jump", queries, timeIt([&] {
+        for (int value : values) sum += static_cast<std::size_t>(begin[static_cast<std::ptrdiff_t>(static_cast<std::size_t>(value) % container.primeCount())]);
+    }));
+    const std::size_t counted = 100;
+    report("prime-seek count by iterating", counted, timeIt([&] {
+        for (std::size_t query = 0; query < counted; ++query)
+        {
+            for (int prime : container.primes())
+            {
+                if (prime >= values[query]) break;
+                ++sum;
+            }
+        }
+    }));
+    std::cout << "checksum " << sum << std::endl;
+}
+
+// build from an unsorted array with 1 to 8 threads (and every hardware thread) against the sequential batch add
+static void benchBuild()
+{
+    const std::size_t n = 20000000;
+    std::vector<int> values = randomValues(n);
+    {
+        MagicalContainer container;
+        report("build add-elements", n, timeIt([&] { container.addElements(values); }));
+    }
+    std::vector<std::size_t> thread_counts = {1, 2, 4, 8};
+    if (std::thread::hardware_concurrency() > 8) thread_counts.push_back(std::thread::hardware_concurrency());
+    for (std::size_t threads : thread_counts)
+    {
+        MagicalContainer container;
+        report("build threads=" + std::to_string(threads), n, timeIt([&] { container.build(values, {threads}); }));
+    }
+}
+
+// sum, min, max and count of every order in one parallel reduction, on 1, 4, 16 and every hardware thread, against one
+// sequential loop
+struct Summary
+{
+    long long sum = 0;
+    int min = INT_MAX;
+    int max = INT_MIN;
+    std::size_t count = 0;
+};
+
+static void benchParallelReduce()
+{
+    const std::size_t n = 20000000;
+    MagicalContainer container;
+    container.build(randomValues(n), {1});
+    auto fold = [](Summary summary, int element) {
+        summary.sum += element;
+        summary.min = std::min(summary.min, element);
+        summary.max = std::max(summary.max, element);
+        ++summary.count;
+        return summary;
+    };
+    auto combine = [](Summary left, const Summary &right) {
+        left.sum += right.sum;
+        left.min = std::min(left.min, right.min);
+        left.max = std::max(left.max, right.max);
+        left.count += right.count;
+        return left;
+    };
+
+    long long checksum = 0;
+    auto benchOrder = [&](const std::string &name, auto view) {
+        auto size = static_cast<std::size_t>(view.end() - view.begin());
+        report("parallel-reduce " + name + " sequential", size, timeIt([&] {
+            Summary summary;
+            for (int element : view) summary = fold(summary, element);
+            checksum += summary.sum + static_cast<long long>(summary.count);
+        }));
+        std::vector<std::size_t> thread_counts = {1, 4, 16};
+        if (std::thread::hardware_concurrency() > 16) thread_counts.push_back(std::thread::hardware_concurrency());
+        for (std::size_t threads : thread_counts)
+        {
+            ThreadPool pool(threads);
+            report("parallel-reduce " + name + " threads=" + std::to_string(threads), size, timeIt([&] {
+                Summary summary = parallelReduce(pool, view, Summary{}, fold, combine);
+                checksum += summary.sum + static_cast<long long>(summary.count);
+            }));
+        }
+    };
+    benchOrder("ascending", container.ascending());
+    benchOrder("side-cross", container.sideCross());
+    benchOrder("primes", container.primes());
+    std::cout << "checksum " << checksum << std::endl;
+}
+
+// near sorted ingest: addElement one by one against a producer thread that stages into the ring while the owner merges
+// in batches. reports the stage latency percentiles of every 64th push and the merge throughput
+static void benchStaging()
+{
+    const std::size_t n = 5000000;
+    std::vector<int> values(n);
+    std::mt19937 random(3);
+    for (std::size_t i = 0; i < n; ++i) values[i] = static_cast<int>(i * 2) + static_cast<int>(random() % 17) - 8;
+
+    {
+        MagicalContainer container;
+        report("staging add-element", n, timeIt([&] { for (int value : values) container.addElement(value); }));
+    }
+
+    MagicalContainer container;
+    container.reserveStaging(1U << 16U);
+    std::vector<double> latencies;
+    std::size_t full = 0;
+    double merge_seconds = 0;
+    std::size_t merges = 0;
+    double total = timeIt([&] {
+        std::thread producer([&] {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                auto before = std::chrono::steady_clock::now();
+                while (!container.stageElement(values[i]))
+                {
+                    ++full;
+                    std::this_thread::yield();
+                }
+                if ((i & 63U) == 0) latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - before).count());
+            }
+        });
+        for (std::size_t merged = 0; merged < n;)
+        {
+            std::size_t batch = 0;
+            merge_seconds += timeIt([&] { batch = container.mergeStaged(); });
+            merged += batch;
+            if (batch > 0) ++merges;
+            else std::this_thread::yield();
+        }
+        producer.join();
+    });
+
+    auto percentile = [&](double fraction) {
+        auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(fraction * static_cast<double>(latencies.size() - 1));
+        std::nth_element(latencies.begin(), nth, latencies.end());
+        return *nth;
+    };
+    report("staging staged ingest", n, total);
+    report("staging merge", n, merge_seconds);
+    std::cout << "staging stage latency p50=" << percentile(0.5) << "ns p99=" << percentile(0.99) << "ns max=" << percentile(1.0) << "ns full=" << full
+              << " merges=" << merges << " size=" << container.size() << std::endl;
+}
+
+// latency of single reads while a writer adds 100K elements per second in batches of 1000. the reader either takes
+// the latest snapshot or locks the mutex the writer holds while it merges
+static void benchSnapshotReadsRun(const std::string &name, bool snapshots)
+{
+    const auto duration = std::chrono::seconds(2);
+    const std::size_t batch = 1000;
+    const auto period = std::chrono::milliseconds(10);
+    MagicalContainer container;
+    std::vector<int> values = randomValues(1000000);
+    for (int &value : values) value *= 2;
+    container.addElements(values);
+    container.publish();
+    std::mutex mutex;
+
+    std::atomic<bool> stop = false;
+    std::size_t inserted = 0;
+    std::thread writer([&] {
+        std::mt19937 random(1);
+        auto next = std::chrono::steady_clock::now();
+        while (!stop)
+        {
+            std::vector<int> added(batch);
+            for (int &value : added) value = static_cast<int>(random() % 2000000) * 2 + 1;
+            if (snapshots)
+            {
+                container.addElements(added);
+                container.publish();
+            }
+            else
+            {
+                std::scoped_lock lock(mutex);
+                container.addElements(added);
+            }
+            inserted += batch;
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+    });
+
+    std::vector<double> latencies;
+    std::mt19937 random(2);
+    std::size_t found = 0;
+    auto end = std::chrono::steady_clock::now() + duration;
+    for (auto now = std::chrono::steady_clock::now(); now < end;)
+    {
+        int value = static_cast<int>(random() % 4000000);
+        if (snapshots)
+        {
+            if (container.latestPublished()->contains(value)) ++found;
+        }
+        else
+        {
+            std::scoped_lock lock(mutex);
+            if (container.contains(value)) ++found;
+        }
+        auto after = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration<double, std::micro>(after - now).count());
+        now = after;
+    }
+    stop = true;
+    writer.join();
+
+    auto percentile = [&](double fraction) {
+        auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(fraction * static_cast<double>(latencies.size() - 1));
+        std::nth_element(latencies.begin(), nth, latencies.end());
+        return *nth;
+    };
+    double seconds = std::chrono::duration<double>(duration).count();
+    std::cout << "snapshot-reads " << name << " reads=" << latencies.size() << " p50=" << percentile(0.5) << "us p99=" << percentile(0.99)
+              << "us p99.9=" << percentile(0.999) << "us max=" << percentile(1.0) << "us inserts=" << static_cast<double>(inserted) / seconds << "/s found=" << found << std::endl;
+}
+
+static void benchSnapshotReads()
+{
+    // publish cost after a batch of 1000 elements spread over the whole container against one that falls in a narrow range
+    MagicalContainer container;
+    std::vector<int> values = randomValues(1000000);
+    for (int &value : values) value *= 2;
+    container.addElements(values);
+    container.publish();
+    std::vector<int> spread = randomValues(1000);
+    std::vector<int> narrow = spread;
+    for (int &value : spread) value = value * 2000 + 1;
+    for (int &value : narrow) value = value * 2 + 1000001;
+    container.addElements(spread);
+    report("snapshot-reads publish spread batch", 1, timeIt([&] { container.publish(); }));
+    container.addElements(narrow);
+    report("snapshot-reads publish narrow batch", 1, timeIt([&] { container.publish(); }));
+
+    benchSnapshotReadsRun("mutex", false);
+    benchSnapshotReadsRun("snapshot", true);
+}
+
+// ops per second of a mixed workload, one write in every eight operations, run by a growing number of threads for a
+// fixed time. the whole container behind one mutex against the range sharded container
+template <class Container>
+static void benchConcurrentRun(const std::string &name, Container &container, std::size_t threads)
+{
+    const auto duration = std::chrono::milliseconds(200);
+    const int range = 1000000;
+    std::atomic<bool> stop = false;
+    std::atomic<std::size_t> operations = 0;
+    std::vector<std::thread> workers;
+    for (std::size_t thread = 0; thread < threads; ++thread)
+    {
+        workers.emplace_back([&, thread] {
+            std::mt19937 random(static_cast<unsigned>(thread));
+            std::uniform_int_distribution<int> values(0, range - 1);
+            std::size_t done = 0;
+            for (; !stop.load(std::memory_order_relaxed); ++done)
+            {
+                int value = values(random); // every thread writes only its own residue class, so the check and the write do not race
+                if ((done & 7U) == 0) value = value - value % static_cast<int>(threads) + static_cast<int>(thread);
+                if ((done & 7U) != 0) container.contains(value);
+                else if (container.contains(value)) container.removeElement(value);
+                else container.addElement(value);
+            }
+            operations += done;
+        });
+    }
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto &worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(duration).count();
+    std::cout << "concurrent " << name << " threads=" << threads << " rate=" << static_cast<double>(operations) / seconds << "/s" << std::endl;
+}
+
+// MagicalContainer behind a single mutex, the baseline of benchConcurrent
+class LockedMagicalContainer
+{
+    mutable std::mutex mutex_;
+    MagicalContainer container_;
+
+public:
+    void addElement(int element) {std::scoped_lock lock(mutex_); container_.addElement(element);}
+    void removeElement(int element) {std::scoped_lock lock(mutex_); container_.removeElement(element);}
+    bool contains(int element) const {std::scoped_lock lock(mutex_); return container_.contains(element);}
+};
+
+static void benchConcurrent()
+{
+    std::vector<int> values = randomValues(500000);
+    for (int &value : values) value %= 1000000;
+    for (std::size_t threads : {1UL, 2UL, 4UL, 8UL, 16UL, 32UL, 64UL})
+    {
+        LockedMagicalContainer locked;
+        for (int value : values) if (!locked.contains(value)) locked.addElement(value);
+        benchConcurrentRun("global-mutex", locked, threads);
+
+        ConcurrentMagicalContainer sharded(0, 1000000, ConcurrentMagicalContainer::DEFAULT_SHARDS);
+        sharded.addElements(values);
+        benchConcurrentRun("sharded", sharded, threads);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // run every benchmark, or only the one named on the command line
+    std::string only = argc > 1 ? argv[1] : "";
+    if (only.empty() || only == "insert") benchSortedInsert();
+    if (only.empty() || only == "add") benchAddElement();
+    if (only.empty() || only == "ingest") benchIngest();
+    if (only.empty() || only == "copy") benchCopy();
+    if (only.empty() || only == "remove") benchRemoveElement();
+    if (only.empty() || only == "add-batch") benchAddElements();
+    if (only.empty() || only == "remove-batch") benchRemoveElements();
+    if (only.empty() || only == "cross") benchCrossTraversal();
+    if (only.empty() || only == "lower-bound") benchLowerBound();
+    if (only.empty() || only == "sentinel") benchSentinel();
+    if (only.empty() || only == "iterator-sum") benchIteratorSum();
+    if (only.empty() || only == "assignment") benchAssignment();
+    if (only.empty() || only == "primes-take") benchPrimesTake();
+    if (only.empty() || only == "next-batch") benchNextBatches();
+    if (only.empty() || only == "top-k") benchTopK();
+    if (only.empty() || only == "rank-select") benchRankSelect();
+    if (only.empty() || only == "prime-seek") benchPrimeSeek();
+    if (only.empty() || only == "concurrent") benchConcurrent();
+    if (only.empty() || only == "snapshot-reads") benchSnapshotReads();
+    if (only.empty() || only == "build") benchBuild();
+    if (only.empty() || only == "parallel-reduce") benchParallelReduce();
+    if (only.empty() || only == "staging") benchStaging();
+    if (only.empty() || only == "memory")
+    {
+        benchMemory();
+        benchRepetitiveMemory<Duplicates::Multiset>("multiset");
+        benchRepetitiveMemory<Duplicates::Counted>("counted");
+    }
+    return 0;
+}
@@ -1,8 +1,30 @@
 #include "sources/MagicalContainer.hpp"
+#include "sources/ConcurrentMagicalContainer.hpp"
+#include "sources/ThreadPool.hpp"
+#include "sources/StagingRing.hpp"
 #include "doctest.h"
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <set>
+#include <thread>
 
 using namespace ariel;
 
+// count heap allocations so tests can check that traversals never allocate
+static std::atomic<std::size_t> allocation_count = 0;
+
+void *operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size == 0 ? 1 : size)) return memory;
+    throw std::bad_alloc();
+}
+void operator delete(void *memory) noexcept {std::free(memory);}
+void operator delete(void *memory, std::size_t) noexcept {std::free(memory);}
+
 TEST_CASE("Magical container")
 {
     SUBCASE("constructor")
@@ -192,18 +214,18 @@ TEST_CASE("iterators")
         CHECK(prime_itr==prime_itr_2);
         CHECK(cross_itr==cross_itr_2);
 
-        // test assigment on diffrent MagicalContainer with same container
+        // test assigment on diffrent MagicalContainer with same container, equal contents are still another container
         ++asc_itr_3;
         ++prime_itr_3;
         ++cross_itr_3;
 
-        CHECK_NOTHROW(asc_itr=asc_itr_3);
-        CHECK_NOTHROW(prime_itr=prime_itr_3);
-        CHECK_NOTHROW(cross_itr=cross_itr_3);
+        CHECK_THROWS_AS(asc_itr=asc_itr_3, std::runtime_error);
+        CHECK_THROWS_AS(prime_itr=prime_itr_3, std::runtime_error);
+        CHECK_THROWS_AS(cross_itr=cross_itr_3, std::runtime_error);
 
-        CHECK(asc_itr==asc_itr_3);
-        CHECK(prime_itr==prime_itr_3);
-        CHECK(cross_itr==cross_itr_3);
+        CHECK(asc_itr==asc_itr_2);
+        CHECK(prime_itr==prime_itr_2);
+        CHECK(cross_itr==cross_itr_2);
 
         // test on diffrent containers
         CHECK_THROWS_AS(asc_itr=asc_itr_4, std::runtime_error);
@@ -224,3 +246,1338 @@ TEST_CASE("iterators")
         CHECK(cross_itr == cross_itr.begin());
     }
 }
+
+TEST_CASE("prime sieve")
+{
+    // reference trial division
+    auto isPrime = [](long long number) {
+        if (number < 2) return false;
+        for (long long i = 2; i * i <= number; ++i)
+        {
+            if (number % i == 0) return false;
+        }
+        return true;
+    };
+
+    SUBCASE("sieve agrees with trial division")
+    {
+        PrimeSieve sieve;
+        bool all_match = true;
+        for (int number = -10; number < 200000; ++number)
+        {
+            all_match = all_match && (sieve.isPrime(number) == isPrime(number));
+        }
+        CHECK(all_match);
+        CHECK(sieve.limit() > 200000);
+    }
+
+    SUBCASE("miller rabin above the ceiling")
+    {
+        PrimeSieve sieve(1U << 16);
+        bool all_match = true;
+        for (int number = 2147483647; number > 2147483647 - 2000; --number)
+        {
+            all_match = all_match && (sieve.isPrime(number) == isPrime(number));
+        }
+        CHECK(all_match);
+        CHECK(sieve.isPrime(2147483647)); // mersenne prime
+        CHECK_FALSE(sieve.isPrime(1000000001)); // 7 * 11 * 13 * 19 * 52579
+        CHECK(sieve.isPrime(1000000007));
+        CHECK(sieve.limit() <= (1U << 16) + 128);
+    }
+
+    SUBCASE("batch classify")
+    {
+        PrimeSieve sieve;
+        std::vector<int> elements = {0, 1, 2, 3, 4, 17, 25, -7, 65537, 2147483647};
+        std::vector<bool> flags;
+        sieve.classify(elements, flags);
+        REQUIRE(flags.size() == elements.size());
+        CHECK(flags == std::vector<bool>{false, false, true, true, false, true, false, false, true, true});
+    }
+
+    SUBCASE("elements above the ceiling do not grow the sieve")
+    {
+        PrimeSieve sieve;
+        std::vector<bool> flags;
+        sieve.classify(std::vector<int>{1000000007}, flags);
+        CHECK(flags == std::vector<bool>{true});
+        CHECK(sieve.limit() == 0);
+        sieve.cover(1000000007);
+        CHECK(sieve.limit() == 0);
+        sieve.classify(std::vector<int>{1000000007, 97}, flags);
+        CHECK(flags == std::vector<bool>{true, true});
+        CHECK(sieve.limit() <= (1U << 16) + 128);
+
+        MagicalContainer container;
+        container.build(std::vector<int>{1000000007, 4, 97, 1000000009});
+        std::vector<int> primes;
+        for (int element : container.primes()) primes.push_back(element);
+        CHECK(primes == std::vector<int>{97, 1000000007, 1000000009});
+    }
+}
+
+TEST_CASE("prime view maintenance")
+{
+    SUBCASE("prime iterator sees primes inserted ahead of it")
+    {
+        MagicalContainer container;
+        container.addElement(2);
+        container.addElement(5);
+        MagicalContainer::PrimeIterator prime_itr(container);
+        ++prime_itr;
+        CHECK(*prime_itr == 5);
+
+        container.addElement(8); // not prime
+        container.addElement(7); // ahead of the iterator
+        CHECK(*prime_itr == 5);
+        ++prime_itr;
+        CHECK(*prime_itr == 7);
+        ++prime_itr;
+        CHECK(prime_itr == prime_itr.end());
+    }
+
+    SUBCASE("prime view matches the ascending view after many inserts")
+    {
+        MagicalContainer container;
+        std::vector<int> expected;
+        for (int i = 0; i < 2000; ++i)
+        {
+            int element = (i * 7919) % 2003; // distinct values in scrambled order
+            container.addElement(element);
+        }
+        MagicalContainer::AscendingIterator asc_itr(container);
+        for (auto itr = asc_itr.begin(); itr != asc_itr.end(); ++itr)
+        {
+            if (PrimeSieve().isPrime(*itr)) expected.push_back(*itr);
+        }
+
+        std::vector<int> primes;
+        MagicalContainer::PrimeIterator prime_itr(container);
+        for (auto itr = prime_itr.begin(); itr != prime_itr.end(); ++itr) primes.push_back(*itr);
+        CHECK(primes == expected);
+
+        MagicalContainer copy(container); // copy must point at its own elements
+        std::vector<int> copy_primes;
+        MagicalContainer::PrimeIterator copy_itr(copy);
+        for (auto itr = copy_itr.begin(); itr != copy_itr.end(); ++itr) copy_primes.push_back(*itr);
+        CHECK(copy_primes == expected);
+    }
+}
+
+TEST_CASE("traversal does not allocate")
+{
+    MagicalContainer container;
+    for (int element = 0; element < 1000; ++element) container.addElement(element);
+
+    MagicalContainer::AscendingIterator asc_itr(container);
+    MagicalContainer::SideCrossIterator cross_itr(container);
+    MagicalContainer::PrimeIterator prime_itr(container);
+
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    long long sum = 0;
+    for (auto itr = asc_itr.begin(); itr != asc_itr.end(); ++itr) sum += *itr;
+    for (auto itr = cross_itr.begin(); itr != cross_itr.end(); ++itr) sum += *itr;
+    for (auto itr = prime_itr.begin(); itr != prime_itr.end(); ++itr) sum += *itr;
+    std::size_t allocations = allocation_count.load(std::memory_order_relaxed) - before;
+
+    CHECK(allocations == 0);
+    CHECK(sum == 2 * 499500 + 76127); // sum of 0..999 twice plus the primes below 1000
+    CHECK(container.ascSize() == 1000);
+    CHECK(container.primeCount() == 168);
+    CHECK(container.ascView().size() == 1000);
+    CHECK(container.ascView()[10] == 10);
+    CHECK(container.primeIndex(1) == 3);
+}
+
+TEST_CASE("remove elements keeps every view in sync")
+{
+    SUBCASE("remove updates ascending, cross and prime order")
+    {
+        MagicalContainer container;
+        for (int element : {1, 2, 4, 5, 14}) container.addElement(element);
+        container.removeElement(5);
+        container.removeElement(1);
+
+        std::vector<int> ascending, cross, primes;
+        MagicalContainer::AscendingIterator asc_itr(container);
+        for (auto itr = asc_itr.begin(); itr != asc_itr.end(); ++itr) ascending.push_back(*itr);
+        MagicalContainer::SideCrossIterator cross_itr(container);
+        for (auto itr = cross_itr.begin(); itr != cross_itr.end(); ++itr) cross.push_back(*itr);
+        MagicalContainer::PrimeIterator prime_itr(container);
+        for (auto itr = prime_itr.begin(); itr != prime_itr.end(); ++itr) primes.push_back(*itr);
+
+        CHECK(ascending == std::vector<int>{2, 4, 14});
+        CHECK(cross == std::vector<int>{2, 14, 4});
+        CHECK(primes == std::vector<int>{2});
+        CHECK(container.size() == 3);
+    }
+
+    SUBCASE("randomized against std::set")
+    {
+        MagicalContainer container;
+        std::set<int> reference;
+        std::mt19937 random(7);
+        std::uniform_int_distribution<int> value(-50, 500);
+        PrimeSieve sieve;
+
+        bool views_match = true;
+        for (int step = 0; step < 3000; ++step)
+        {
+            int element = value(random);
+            if (reference.count(element) > 0)
+            {
+                container.removeElement(element);
+                reference.erase(element);
+            }
+            else
+            {
+                container.addElement(element);
+                reference.insert(element);
+            }
+
+            std::vector<int> expected_primes;
+            for (int number : reference)
+            {
+                if (sieve.isPrime(number)) expected_primes.push_back(number);
+            }
+            std::vector<int> primes;
+            for (std::size_t rank = 0; rank < container.primeCount(); ++rank) primes.push_back(container.ascView()[container.primeIndex(rank)]);
+
+            views_match = views_match && container.size() == reference.size() &&
+                          std::equal(reference.begin(), reference.end(), container.ascView().begin(), container.ascView().end()) &&
+                          primes == expected_primes;
+        }
+        CHECK(views_match);
+    }
+}
+
+TEST_CASE("bulk insert")
+{
+    MagicalContainer container;
+    container.addElement(4);
+    container.addElement(11);
+
+    std::vector<int> batch = {17, 2, 4, 9, 2, 25, 3, -1};
+    container.addElements(batch);
+    CHECK(container.size() == 8);
+    CHECK(std::vector<int>(container.ascView().begin(), container.ascView().end()) == std::vector<int>{-1, 2, 3, 4, 9, 11, 17, 25});
+
+    std::vector<int> primes;
+    MagicalContainer::PrimeIterator prime_itr(container);
+    for (auto itr = prime_itr.begin(); itr != prime_itr.end(); ++itr) primes.push_back(*itr);
+    CHECK(primes == std::vector<int>{2, 3, 11, 17});
+
+    container.addElements(std::views::iota(20, 30)); // any input range, 25 is already in
+    CHECK(container.size() == 17);
+    CHECK(container.primeCount() == 6);
+}
+
+TEST_CASE("bulk remove")
+{
+    MagicalContainer container;
+    container.addElements(std::views::iota(0, 20));
+
+    SUBCASE("remove present elements")
+    {
+        CHECK(container.removeElements(std::vector<int>{3, 0, 19, 3, 8}).empty());
+        CHECK(container.size() == 16);
+        CHECK(container.ascView().front() == 1);
+        CHECK(container.ascView().back() == 18);
+        CHECK(container.primeCount() == 6); // 2 5 7 11 13 17
+    }
+
+    SUBCASE("missing elements policy")
+    {
+        CHECK_THROWS_AS(container.removeElements(std::vector<int>{1, 50}), std::runtime_error);
+        CHECK(container.size() == 20); // nothing removed on throw
+
+        CHECK(container.removeElements(std::vector<int>{1, 50}, MissingElements::Skip).empty());
+        CHECK(container.size() == 19);
+
+        CHECK(container.removeElements(std::vector<int>{-4, 2, 1, 60}, MissingElements::Report) == std::vector<int>{-4, 1, 60});
+        CHECK(container.size() == 18);
+        CHECK(container.primeCount() == 7);
+    }
+}
+
+TEST_CASE("elements are stored once")
+{
+    MagicalContainer container;
+    container.addElement(5);
+    container.addElement(5);
+    container.addElements(std::vector<int>{5, 6, 6});
+    CHECK(container.size() == 2);
+    CHECK(container.ascSize() == container.size());
+    CHECK(container.contains(6));
+    CHECK_FALSE(container.contains(7));
+
+    container.removeElement(5);
+    CHECK_FALSE(container.contains(5));
+    CHECK_THROWS_AS(container.removeElement(5), std::runtime_error);
+}
+
+TEST_CASE("duplicate policies")
+{
+    SUBCASE("multiset stores every copy")
+    {
+        BasicMagicalContainer<Duplicates::Multiset> container;
+        container.addElement(3);
+        container.addElement(3);
+        container.addElements(std::vector<int>{1, 3, 4});
+        CHECK(container.size() == 5);
+        CHECK(container.count(3) == 3);
+        CHECK(container.primeCount() == 3);
+
+        std::vector<int> ascending;
+        BasicMagicalContainer<Duplicates::Multiset>::AscendingIterator asc_itr(container);
+        for (auto itr = asc_itr.begin(); itr != asc_itr.end(); ++itr) ascending.push_back(*itr);
+        CHECK(ascending == std::vector<int>{1, 3, 3, 3, 4});
+
+        container.removeElement(3);
+        CHECK(container.count(3) == 2);
+        CHECK(container.removeElements(std::vector<int>{3, 3, 3}, MissingElements::Report) == std::vector<int>{3});
+        CHECK(container.size() == 2);
+        CHECK(container.primeCount() == 0);
+    }
+
+    SUBCASE("counted stores every element once with its count")
+    {
+        BasicMagicalContainer<Duplicates::Counted> container;
+        container.addElement(7);
+        container.addElement(7);
+        container.addElements(std::vector<int>{7, 2, 2, 9});
+        CHECK(container.size() == 3);
+        CHECK(container.totalCount() == 6);
+        CHECK(container.ascSize() == 3);
+        CHECK(container.count(7) == 3);
+        CHECK(container.count(2) == 2);
+        CHECK(container.primeCount() == 2);
+
+        container.removeElement(7);
+        CHECK(container.count(7) == 2);
+        CHECK(container.ascSize() == 3);
+        CHECK_THROWS_AS(container.removeElements(std::vector<int>{2, 2, 2}), std::runtime_error);
+        CHECK(container.removeElements(std::vector<int>{2, 2, 2, 7}, MissingElements::Report) == std::vector<int>{2});
+        CHECK(container.size() == 2);
+        CHECK(container.totalCount() == 2);
+        CHECK(container.ascSize() == 2);
+        CHECK(container.primeCount() == 1);
+        CHECK_FALSE(container.contains(2));
+    }
+
+    SUBCASE("size is the number of elements every order visits")
+    {
+        BasicMagicalContainer<Duplicates::Counted> container;
+        container.addElements(std::vector<int>{5, 5, 5, 8, 8, 13});
+        CHECK(container.size() == 3);
+        CHECK(container.totalCount() == 6);
+        CHECK(static_cast<std::size_t>(std::ranges::distance(container)) == container.size());
+        CHECK(container.ascending().size() == container.size());
+        CHECK(container.sideCross().size() == container.size());
+        std::vector<int> batch(8);
+        CHECK(container.ascending().begin().nextBatch(batch) == container.size());
+
+        BasicMagicalContainer<Duplicates::Multiset> multiset;
+        multiset.addElements(std::vector<int>{5, 5, 5, 8, 8, 13});
+        CHECK(multiset.size() == 6);
+        CHECK(multiset.totalCount() == multiset.size());
+        CHECK(static_cast<std::size_t>(std::ranges::distance(multiset)) == multiset.size());
+    }
+}
+
+TEST_CASE("side cross order")
+{
+    SUBCASE("comparison follows cross order")
+    {
+        MagicalContainer container;
+        container.addElements(std::vector<int>{1, 2, 4, 5, 14});
+        MagicalContainer::SideCrossIterator first(container);
+        MagicalContainer::SideCrossIterator second(container);
+        ++second; // 14
+        MagicalContainer::SideCrossIterator fourth(container);
+        ++fourth;
+        ++fourth;
+        ++fourth; // 5
+        CHECK(*second == 14);
+        CHECK(*fourth == 5);
+        CHECK(fourth > second);
+        CHECK(second > first);
+    }
+
+    SUBCASE("emit pairs matches the iterator for odd and even sizes")
+    {
+        bool all_match = true;
+        for (int size = 0; size < 12; ++size)
+        {
+            MagicalContainer container;
+            container.addElements(std::views::iota(0, size));
+
+            std::vector<int> expected;
+            MagicalContainer::SideCrossIterator cross_itr(container);
+            for (auto itr = cross_itr.begin(); itr != cross_itr.end(); ++itr) expected.push_back(*itr);
+
+            for (std::size_t chunk = 1; chunk < 5; ++chunk)
+            {
+                std::vector<int> emitted;
+                std::vector<int> buffer(chunk);
+                MagicalContainer::SideCrossIterator batch_itr(container);
+                std::size_t written = 0;
+                while ((written = batch_itr.emitPairs(buffer)) > 0) emitted.insert(emitted.end(), buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(written));
+                all_match = all_match && emitted == expected && batch_itr == batch_itr.end();
+            }
+        }
+        CHECK(all_match);
+    }
+}
+
+TEST_CASE("ascending iterator random access")
+{
+    MagicalContainer container;
+    container.addElements(std::vector<int>{1, 2, 4, 5, 14});
+    MagicalContainer::AscendingIterator asc_itr(container);
+    auto begin = asc_itr.begin();
+    auto end = asc_itr.end();
+
+    CHECK(end - begin == 5);
+    CHECK(std::distance(begin, end) == 5);
+    CHECK(begin[3] == 5);
+    CHECK(*(begin + 4) == 14);
+    CHECK(*(2 + begin) == 4);
+    CHECK(*(end - 1) == 14);
+    CHECK(*std::lower_bound(begin, end, 3) == 4);
+    CHECK(std::ranges::is_sorted(begin, end));
+    CHECK(std::to_address(end) == container.ascView().data() + 5);
+
+    auto itr = end;
+    --itr;
+    CHECK(*itr-- == 14);
+    CHECK(*itr == 5);
+    CHECK(begin <= itr);
+    CHECK(end >= itr);
+    CHECK_THROWS_AS(--begin, std::runtime_error);
+
+    MagicalContainer::AscendingIterator unattached;
+    unattached = itr;
+    CHECK(*unattached == 5);
+}
+
+TEST_CASE("sentinel end")
+{
+    MagicalContainer container;
+    container.addElements(std::vector<int>{1, 2, 4, 5, 14});
+
+    int sum = 0;
+    for (int element : container) sum += element;
+    CHECK(sum == 26);
+    CHECK(container.end() - container.begin() == 5);
+    CHECK(std::ranges::distance(container) == 5);
+    CHECK(*std::ranges::find(container, 5) == 5);
+
+    // the sentinel tracks the live size, elements added later are visited
+    container.addElement(7);
+    CHECK(std::ranges::distance(container) == 6);
+
+    MagicalContainer::SideCrossIterator cross_itr(container);
+    std::vector<int> cross;
+    for (auto itr = cross_itr.begin(); itr != MagicalContainer::SideCrossSentinel{}; ++itr) cross.push_back(*itr);
+    CHECK(cross == std::vector<int>{1, 14, 2, 7, 4, 5});
+
+    MagicalContainer::PrimeIterator prime_itr(container);
+    std::vector<int> primes;
+    for (auto itr = prime_itr.begin(); itr != MagicalContainer::PrimeSentinel{}; ++itr) primes.push_back(*itr);
+    CHECK(primes == std::vector<int>{2, 5, 7});
+
+    MagicalContainer empty;
+    CHECK(empty.begin() == empty.end());
+}
+
+TEST_CASE("checked iterators detect removals")
+{
+    MagicalContainer container;
+    container.addElements(std::vector<int>{2, 3, 4, 5});
+    MagicalContainer::AscendingIterator asc_itr(container);
+    MagicalContainer::SideCrossIterator cross_itr(container);
+    MagicalContainer::PrimeIterator prime_itr(container);
+
+    // adding keeps every position valid
+    container.addElement(7);
+    CHECK(*asc_itr == 2);
+    CHECK(*cross_itr == 2);
+    CHECK(*prime_itr == 2);
+
+    // a batch that removes nothing keeps them valid too
+    container.removeElements(std::vector<int>{60}, MissingElements::Skip);
+    CHECK(*asc_itr == 2);
+
+    container.removeElement(4);
+    CHECK_THROWS_AS(*asc_itr, std::runtime_error);
+    CHECK_THROWS_AS(*cross_itr, std::runtime_error);
+    CHECK_THROWS_AS(*prime_itr, std::runtime_error);
+    std::vector<int> buffer(2);
+    CHECK_THROWS_AS(cross_itr.emitPairs(buffer), std::runtime_error);
+
+    // iterators made after the removal are valid, and so are iterators assigned from them
+    CHECK(*asc_itr.begin() == 2);
+    asc_itr = asc_itr.begin();
+    CHECK(*asc_itr == 2);
+    CHECK(*cross_itr.begin() == 2);
+    CHECK(*prime_itr.begin() == 2);
+
+    container.removeElements(std::vector<int>{2, 3});
+    CHECK_THROWS_AS(*asc_itr, std::runtime_error);
+
+    // assigning another container replaces the state, so an iterator of the old state never trusts its position
+    MagicalContainer target;
+    target.addElements(std::vector<int>{4, 6, 8, 9, 11});
+    MagicalContainer source;
+    source.addElements(std::vector<int>{2, 3, 5, 7, 10});
+    MagicalContainer::PrimeIterator old_prime(target);
+    CHECK(*old_prime == 11);
+    target = source;
+    CHECK_THROWS_AS(*old_prime, std::runtime_error);
+    std::vector<int> primes;
+    for (int element : target.primes()) primes.push_back(element);
+    CHECK(primes == std::vector<int>{2, 3, 5, 7});
+    CHECK(*MagicalContainer::PrimeIterator(target) == 2);
+}
+
+TEST_CASE("order views")
+{
+    MagicalContainer container;
+    container.addElements(std::vector<int>{1, 2, 4, 5, 14, 17});
+
+    auto to_vector = [](auto &&range) {
+        std::vector<int> elements;
+        for (int element : range) elements.push_back(element);
+        return elements;
+    };
+    CHECK(to_vector(container.ascending()) == std::vector<int>{1, 2, 4, 5, 14, 17});
+    CHECK(to_vector(container.sideCross()) == std::vector<int>{1, 17, 2, 14, 4, 5});
+    CHECK(to_vector(container.primes()) == std::vector<int>{2, 5, 17});
+
+    CHECK(container.ascending().size() == 6);
+    CHECK(container.sideCross().size() == 6);
+    CHECK(container.primes().size() == 3);
+    CHECK(container.ascending()[2] == 4);
+    CHECK(container.primes().front() == 2);
+    CHECK_FALSE(MagicalContainer().primes());
+
+    // lazy pipelines
+    auto even = [](int element) { return element % 2 == 0; };
+    auto square = [](int element) { return element * element; };
+    CHECK(to_vector(container.ascending() | std::views::filter(even)) == std::vector<int>{2, 4, 14});
+    CHECK(to_vector(container.primes() | std::views::take(2)) == std::vector<int>{2, 5});
+    CHECK(to_vector(container.sideCross() | std::views::transform(square) | std::views::take(3)) == std::vector<int>{1, 289, 4});
+
+    // borrowed, iterators from a temporary view are usable
+    auto found = std::ranges::find(container.primes(), 5);
+    CHECK(*found == 5);
+    CHECK(*std::ranges::lower_bound(container.ascending(), 6) == 14);
+
+    // views follow the container
+    container.addElement(3);
+    CHECK(to_vector(container.primes()) == std::vector<int>{2, 3, 5, 17});
+}
+
+TEST_CASE("next batch")
+{
+    // every order, every chunk size, matches the element by element traversal
+    auto drain = [](auto itr, std::size_t chunk) {
+        std::vector<int> emitted;
+        std::vector<int> buffer(chunk);
+        std::size_t written = 0;
+        while ((written = itr.nextBatch(buffer)) > 0) emitted.insert(emitted.end(), buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(written));
+        return std::make_pair(emitted, itr == itr.end());
+    };
+    auto walk = [](auto itr) {
+        std::vector<int> elements;
+        for (; itr != itr.end(); ++itr) elements.push_back(*itr);
+        return elements;
+    };
+
+    bool all_match = true;
+    for (int size = 0; size < 20; ++size)
+    {
+        MagicalContainer container;
+        container.addElements(std::views::iota(0, size));
+        for (std::size_t chunk = 1; chunk < 6; ++chunk)
+        {
+            auto ascending = drain(MagicalContainer::AscendingIterator(container), chunk);
+            auto cross = drain(MagicalContainer::SideCrossIterator(container), chunk);
+            auto primes = drain(MagicalContainer::PrimeIterator(container), chunk);
+            all_match = all_match && ascending.second && cross.second && primes.second;
+            all_match = all_match && ascending.first == walk(MagicalContainer::AscendingIterator(container));
+            all_match = all_match && cross.first == walk(MagicalContainer::SideCrossIterator(container));
+            all_match = all_match && primes.first == walk(MagicalContainer::PrimeIterator(container));
+        }
+    }
+    CHECK(all_match);
+
+    // a batch continues from the iterator position
+    MagicalContainer container;
+    container.addElements(std::vector<int>{1, 2, 4, 5, 14});
+    MagicalContainer::AscendingIterator asc_itr(container);
+    ++asc_itr;
+    std::vector<int> buffer(2);
+    CHECK(asc_itr.nextBatch(buffer) == 2);
+    CHECK(buffer == std::vector<int>{2, 4});
+    CHECK(*asc_itr == 5);
+    std::vector<int> empty;
+    CHECK(asc_itr.nextBatch(empty) == 0);
+}
+
+TEST_CASE("reverse traversal")
+{
+    MagicalContainer container;
+    container.addElements(std::vector<int>{1, 2, 4, 5, 14, 17});
+
+    std::vector<int> descending(container.rbegin(), container.rend());
+    CHECK(descending == std::vector<int>{17, 14, 5, 4, 2, 1});
+
+    MagicalContainer::SideCrossIterator cross_itr(container);
+    std::vector<int> cross_reversed(cross_itr.rbegin(), cross_itr.rend());
+    CHECK(cross_reversed == std::vector<int>{5, 4, 14, 2, 17, 1});
+
+    MagicalContainer::PrimeIterator prime_itr(container);
+    std::vector<int> primes_reversed(prime_itr.rbegin(), prime_itr.rend());
+    CHECK(primes_reversed == std::vector<int>{17, 5, 2});
+
+    // top k largest from the views, no copy of the container
+    std::vector<int> top;
+    for (int prime : container.primes().reversed() | std::views::take(2)) top.push_back(prime);
+    CHECK(top == std::vector<int>{17, 5});
+    CHECK(*container.ascending().rbegin() == 17);
+    CHECK(*container.sideCross().rbegin() == 5);
+
+    // -- walks back and stops at the beginning
+    auto itr = prime_itr.end();
+    CHECK(*--itr == 17);
+    CHECK(*itr-- == 17);
+    CHECK(*itr == 5);
+    --itr;
+    CHECK_THROWS_AS(--itr, std::runtime_error);
+    auto cross = cross_itr.end();
+    --cross;
+    CHECK(*cross == 5);
+    CHECK_THROWS_AS(--cross_itr, std::runtime_error);
+
+    MagicalContainer empty;
+    CHECK(empty.rbegin() == empty.rend());
+}
+
+TEST_CASE("side cross random access")
+{
+    SUBCASE("position and asc index mapping is a bijection for odd and even sizes")
+    {
+        bool bijection = true;
+        for (std::size_t size = 1; size < 64; ++size)
+        {
+            std::vector<bool> seen(size, false);
+            for (std::size_t position = 0; position < size; ++position)
+            {
+                std::size_t index = MagicalContainer::SideCrossIterator::ascIndex(position, size);
+                bijection = bijection && index < size && !seen[index];
+                if (index < size) seen[index] = true;
+                bijection = bijection && MagicalContainer::SideCrossIterator::crossPosition(index, size) == position;
+            }
+        }
+        CHECK(bijection);
+    }
+
+    SUBCASE("jumps match stepping")
+    {
+        bool all_match = true;
+        for (int size = 0; size < 16; ++size)
+        {
+            MagicalContainer container;
+            container.addElements(std::views::iota(0, size));
+            std::vector<int> stepped;
+            for (int element : container.sideCross()) stepped.push_back(element);
+
+            auto begin = container.sideCross().begin();
+            auto end = begin.end();
+            all_match = all_match && end - begin == size && std::ranges::distance(container.sideCross()) == size;
+            for (int k = 0; k < size; ++k)
+            {
+                auto itr = begin;
+                itr += k;
+                all_match = all_match && *itr == stepped[static_cast<std::size_t>(k)] && begin[k] == *itr && *(k + begin) == *itr;
+                all_match = all_match && *(end - (size - k)) == *itr && itr - begin == k;
+                all_match = all_match && itr.ascIndex() == static_cast<std::size_t>(*itr) && itr.position() == static_cast<std::size_t>(k);
+            }
+        }
+        CHECK(all_match);
+    }
+
+    SUBCASE("split into disjoint parts")
+    {
+        MagicalContainer container;
+        container.addElements(std::views::iota(0, 11));
+        std::vector<int> whole;
+        for (int element : container.sideCross()) whole.push_back(element);
+
+        for (std::size_t parts = 1; parts < 5; ++parts)
+        {
+            std::vector<int> joined;
+            for (std::size_t part = 0; part < parts; ++part)
+            {
+                for (int element : container.sideCross().part(part, parts)) joined.push_back(element);
+            }
+            CHECK(joined == whole);
+        }
+        auto first = container.sideCross().part(0, 2);
+        auto second = container.sideCross().part(1, 2);
+        CHECK(first.size() == 5);
+        CHECK(second.size() == 6);
+        CHECK(first.end() == second.begin());
+        CHECK(first.begin() < second.begin());
+        CHECK(second.begin() >= first.end());
+    }
+}
+
+TEST_CASE("rank select")
+{
+    // every query against a plain vector of bools, across many block and sample boundaries
+    auto matches = [](const RankSelect &bits, const std::vector<bool> &reference) {
+        bool all_match = bits.size() == reference.size();
+        std::size_t ones = 0;
+        for (std::size_t position = 0; position < reference.size() && all_match; ++position)
+        {
+            all_match = bits.test(position) == reference[position] && bits.rank(position) == ones;
+            if (reference[position]) all_match = all_match && bits.select(ones++) == position;
+        }
+        all_match = all_match && bits.ones() == ones && bits.rank(reference.size()) == ones;
+        return all_match;
+    };
+
+    std::mt19937 random(11);
+    for (double density : {0.01, 0.05, 0.5, 1.0})
+    {
+        std::bernoulli_distribution bit(density);
+        RankSelect bits;
+        std::vector<bool> reference;
+        for (std::size_t i = 0; i < 20000; ++i)
+        {
+            bool value = bit(random);
+            bits.pushBack(value);
+            reference.push_back(value);
+        }
+        bits.build();
+        CHECK(matches(bits, reference));
+
+        // next and previous set bit
+        bool scans_match = true;
+        for (std::size_t position = 0; position < reference.size(); position += 7)
+        {
+            std::size_t next = position;
+            while (next < reference.size() && !reference[next]) ++next;
+            scans_match = scans_match && bits.nextOne(position) == next;
+            std::size_t previous = position + 1;
+            while (previous > 0 && !reference[previous - 1]) --previous;
+            scans_match = scans_match && bits.prevOne(position) == (previous == 0 ? reference.size() : previous - 1);
+        }
+        CHECK(scans_match);
+
+        // single bit edits keep the indexes valid
+        std::uniform_int_distribution<std::size_t> position(0, reference.size() - 1);
+        for (int edit = 0; edit < 300; ++edit)
+        {
+            std::size_t at = position(random);
+            if (edit % 2 == 0)
+            {
+                bool value = bit(random);
+                bits.insert(at, value);
+                reference.insert(reference.begin() + static_cast<std::ptrdiff_t>(at), value);
+            }
+            else
+            {
+                bits.erase(at);
+                reference.erase(reference.begin() + static_cast<std::ptrdiff_t>(at));
+            }
+        }
+        CHECK(matches(bits, reference));
+    }
+
+    // indexes stay under 5% of 32 bit element storage
+    RankSelect bits;
+    for (std::size_t i = 0; i < 1000000; ++i) bits.pushBack(i % 3 == 0);
+    bits.build();
+    CHECK(bits.memoryBytes() * 100 < 1000000 * sizeof(int) * 5);
+
+    RankSelect empty;
+    empty.build();
+    CHECK(empty.ones() == 0);
+    CHECK(empty.nextOne(0) == 0);
+    CHECK(empty.prevOne(0) == 0);
+}
+
+TEST_CASE("prime rank and select")
+{
+    MagicalContainer container;
+    container.addElements(std::views::iota(0, 100)); // primes 2 3 5 7 11 .. 97, 25 of them
+
+    CHECK(container.primeCount() == 25);
+    CHECK(container.primesBefore(0) == 0);
+    CHECK(container.primesBefore(3) == 1);
+    CHECK(container.primesBefore(4) == 2);
+    CHECK(container.primesBefore(98) == 25);
+    CHECK(container.primeIndex(4) == 11);
+    CHECK(container.primeRank(11) == 4);
+
+    auto begin = container.primes().begin();
+    CHECK(begin[4] == 11);
+    CHECK(*(begin + 24) == 97);
+    CHECK(container.primes().end() - begin == 25);
+    auto itr = begin;
+    itr += 10;
+    CHECK(*itr == 31);
+    CHECK(itr.rank() == 10);
+    CHECK(itr.ascIndex() == 31);
+    ++itr;
+    CHECK(*itr == 37);
+    itr -= 2;
+    CHECK(*itr-- == 29);
+    CHECK(*itr == 23);
+    CHECK(itr - begin == 8);
+    CHECK(begin < itr);
+    CHECK(itr >= begin);
+
+    // the cached position follows elements added after the iterator was made
+    MagicalContainer::PrimeIterator cached(container, 1);
+    CHECK(*cached == 3);
+    container.addElements(std::vector<int>{-5, -1});
+    CHECK(*cached == 3);
+    ++cached;
+    CHECK(*cached == 5);
+    container.addElement(101);
+    CHECK(*(cached + 23) == 101);
+    CHECK(container.primesBefore(102) == 26);
+}
+
+TEST_CASE("concurrent container")
+{
+    auto collect = [](auto traverse) {
+        std::vector<int> elements;
+        traverse([&](int element) { elements.push_back(element); });
+        return elements;
+    };
+
+    SUBCASE("orders are stitched across shards")
+    {
+        std::vector<int> values;
+        for (int value = -300; value < 700; value += 7) values.push_back(value);
+        MagicalContainer reference;
+        reference.addElements(values);
+
+        for (std::size_t shards : {1UL, 2UL, 5UL, 16UL})
+        {
+            ConcurrentMagicalContainer container(-100, 500, shards);
+            container.addElements(values);
+            CHECK(container.shardCount() == shards);
+            CHECK(container.size() == reference.size());
+            CHECK(container.primeCount() == reference.primeCount());
+            std::vector<int> ascending;
+            for (int element : reference) ascending.push_back(element);
+            CHECK(collect([&](auto visit) { container.forEachAscending(visit); }) == ascending);
+
+            std::vector<int> cross;
+            for (int element : reference.sideCross()) cross.push_back(element);
+            CHECK(collect([&](auto visit) { container.forEachSideCross(visit); }) == cross);
+
+            std::vector<int> primes;
+            for (int element : reference.primes()) primes.push_back(element);
+            CHECK(collect([&](auto visit) { container.forEachPrime(visit); }) == primes);
+        }
+    }
+
+    SUBCASE("single element operations")
+    {
+        ConcurrentMagicalContainer container(std::vector<int>{0, 10});
+        CHECK(container.shardIndex(-5) == 0);
+        CHECK(container.shardIndex(0) == 1);
+        CHECK(container.shardIndex(10) == 2);
+        container.addElement(3);
+        container.addElement(-3);
+        container.addElement(11);
+        container.addElement(3);
+        CHECK(container.size() == 3);
+        CHECK(container.contains(11));
+        CHECK(container.count(3) == 1);
+        container.removeElement(11);
+        CHECK_FALSE(container.contains(11));
+        CHECK_THROWS_AS(container.removeElement(11), std::runtime_error);
+        CHECK(collect([&](auto visit) { container.forEachSideCross(visit); }) == std::vector<int>{-3, 3});
+        CHECK_THROWS_AS(ConcurrentMagicalContainer(std::vector<int>{5, 1}), std::invalid_argument);
+        CHECK_THROWS_AS(ConcurrentMagicalContainer(0, 10, 0), std::invalid_argument);
+    }
+
+    SUBCASE("writers and readers run together")
+    {
+        ConcurrentMagicalContainer container(0, 4000, 8);
+        std::vector<std::thread> threads;
+        std::atomic<bool> sorted = true;
+        for (int writer = 0; writer < 4; ++writer)
+        {
+            threads.emplace_back([&container, writer] {
+                for (int value = writer; value < 4000; value += 4) container.addElement(value);
+            });
+        }
+        for (int reader = 0; reader < 4; ++reader)
+        {
+            threads.emplace_back([&container, &sorted] {
+                for (int round = 0; round < 20; ++round)
+                {
+                    int previous = -1;
+                    container.forEachAscending([&](int element) {
+                        if (element <= previous) sorted = false;
+                        previous = element;
+                    });
+                }
+            });
+        }
+        for (auto &thread : threads) thread.join();
+        CHECK(sorted);
+        CHECK(container.size() == 4000);
+        CHECK(container.primeCount() == 550);
+    }
+}
+
+TEST_CASE("snapshots")
+{
+    auto collect = [](auto traverse) {
+        std::vector<int> elements;
+        traverse([&](int element) { elements.push_back(element); });
+        return elements;
+    };
+    auto orders = [&](MagicalContainer &container, const MagicalSnapshot &snapshot) {
+        std::vector<int> ascending(container.getAscContainer());
+        std::vector<int> cross;
+        for (int element : container.sideCross()) cross.push_back(element);
+        std::vector<int> primes;
+        for (int element : container.primes()) primes.push_back(element);
+        CHECK(snapshot.size() == container.ascSize());
+        CHECK(snapshot.primeCount() == container.primeCount());
+        CHECK(collect([&](auto visit) { snapshot.forEachAscending(visit); }) == ascending);
+        CHECK(collect([&](auto visit) { snapshot.forEachSideCross(visit); }) == cross);
+        CHECK(collect([&](auto visit) { snapshot.forEachPrime(visit); }) == primes);
+    };
+
+    SUBCASE("a snapshot keeps the published elements")
+    {
+        MagicalContainer container;
+        CHECK(container.latestPublished()->size() == 0);
+        std::vector<int> values;
+        for (int value = 0; value < 20000; value += 2) values.push_back(value);
+        container.addElements(values);
+        auto first = container.publish();
+        orders(container, *first);
+        CHECK((*first)[0] == 0);
+        CHECK((*first)[9999] == 19998);
+        CHECK(first->contains(4096));
+        CHECK_FALSE(first->contains(4097));
+
+        container.addElement(4097);
+        container.removeElement(0);
+        CHECK(container.latestPublished() == first); // nothing is visible before the next publish
+        CHECK(first->contains(0));
+        CHECK_FALSE(first->contains(4097));
+        auto second = container.publish();
+        orders(container, *second);
+        CHECK(container.latestPublished() == second);
+    }
+
+    SUBCASE("snapshot publishes only when elements changed")
+    {
+        BasicMagicalContainer<Duplicates::Counted> container;
+        auto empty = container.snapshot();
+        CHECK(empty->size() == 0);
+        CHECK(container.latestPublished() == empty);
+        container.addElements(std::vector<int>{5, 1, 3});
+        auto first = container.snapshot();
+        CHECK(first != empty);
+        CHECK(container.snapshot() == first);
+        container.addElement(3); // only a count changes, the elements do not
+        CHECK(container.snapshot() == first);
+        container.addElement(4);
+        auto second = container.snapshot();
+        CHECK(second != first);
+        CHECK(container.latestPublished() == second);
+        CHECK(std::vector<int>(second->begin(), second->end()) == std::vector<int>{1, 3, 4, 5});
+        container.build(std::vector<int>{9, 8});
+        CHECK(std::vector<int>(container.snapshot()->begin(), container.snapshot()->end()) == std::vector<int>{8, 9});
+    }
+
+    SUBCASE("ascending iterator")
+    {
+        MagicalContainer container;
+        std::vector<int> values;
+        for (int value = 0; value < 30000; ++value) values.push_back(value * 2);
+        container.addElements(values);
+        auto snapshot = container.snapshot();
+        CHECK(snapshot->chunks().size() > 1);
+        CHECK(std::vector<int>(snapshot->begin(), snapshot->end()) == values);
+        CHECK(MagicalSnapshot().begin() == MagicalSnapshot().end());
+    }
+
+    SUBCASE("unchanged chunks are shared")
+    {
+        MagicalContainer container;
+        std::vector<int> values;
+        for (int value = 0; value < 100000; ++value) values.push_back(value * 3);
+        container.addElements(values);
+        auto first = container.publish();
+        container.addElement(150001);
+        auto second = container.publish();
+        orders(container, *second);
+
+        std::size_t shared = 0;
+        for (const auto &chunk : second->chunks())
+        {
+            if (std::find(first->chunks().begin(), first->chunks().end(), chunk) != first->chunks().end()) ++shared;
+            CHECK(chunk->elements.size() <= MagicalSnapshot::CHUNK_SIZE);
+        }
+        CHECK(shared + 2 >= first->chunks().size());
+    }
+
+    SUBCASE("duplicates and many small changes")
+    {
+        std::mt19937 random(7);
+        BasicMagicalContainer<Duplicates::Multiset> container;
+        for (int round = 0; round < 40; ++round)
+        {
+            for (int i = 0; i < 300; ++i) container.addElement(static_cast<int>(random() % 5000));
+            for (int i = 0; i < 100; ++i)
+            {
+                int value = static_cast<int>(random() % 5000);
+                if (container.contains(value)) container.removeElement(value);
+            }
+            auto snapshot = container.publish();
+            std::vector<int> ascending(container.getAscContainer());
+            CHECK(collect([&](auto visit) { snapshot->forEachAscending(visit); }) == ascending);
+            CHECK(snapshot->primeCount() == container.primeCount());
+        }
+    }
+
+    SUBCASE("copies of one element spread over many chunks")
+    {
+        BasicMagicalContainer<Duplicates::Multiset> container;
+        container.addElements(std::vector<int>(20000, 7));
+        container.addElements(std::vector<int>(5000, 9));
+        auto first = container.publish();
+        CHECK(first->chunks().size() > 2);
+        container.addElement(3);
+        container.addElement(8);
+        container.removeElement(9);
+        auto second = container.publish();
+        CHECK(std::vector<int>(second->begin(), second->end()) == container.getAscContainer());
+        std::size_t shared = 0;
+        for (const auto &chunk : second->chunks())
+        {
+            if (std::find(first->chunks().begin(), first->chunks().end(), chunk) != first->chunks().end()) ++shared;
+        }
+        CHECK(shared > 0);
+    }
+
+    SUBCASE("readers walk snapshots while the writer publishes")
+    {
+        MagicalContainer container;
+        std::atomic<bool> done = false;
+        std::atomic<bool> sorted = true;
+        std::thread reader([&] {
+            while (!done)
+            {
+                auto snapshot = container.latestPublished();
+                int previous = INT_MIN;
+                bool first = true;
+                snapshot->forEachAscending([&](int element) {
+                    if (!first && element <= previous) sorted = false;
+                    previous = element;
+                    first = false;
+                });
+            }
+        });
+        for (int value = 0; value < 20000; ++value)
+        {
+            container.addElement((value * 7919) % 20000);
+            if (value % 100 == 0) container.publish();
+        }
+        done = true;
+        reader.join();
+        CHECK(sorted);
+        CHECK(container.publish()->size() == 20000);
+    }
+}
+
+TEST_CASE("parallel build")
+{
+    std::mt19937 random(11);
+    std::vector<int> values(5003);
+    for (int &value : values) value = static_cast<int>(random() % 4000) - 100;
+
+    SUBCASE("parallel sort matches std::sort")
+    {
+        for (std::size_t threads : {1UL, 2UL, 3UL, 5UL, 8UL})
+        {
+            for (std::size_t size : {0UL, 1UL, 7UL, 5003UL})
+            {
+                std::vector<int> sorted(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(size));
+                std::vector<int> expected = sorted;
+                std::sort(expected.begin(), expected.end());
+                parallelSort(sorted, threads);
+                CHECK(sorted == expected);
+            }
+        }
+    }
+
+    SUBCASE("every policy matches addElements")
+    {
+        for (std::size_t threads : {1UL, 2UL, 3UL, 4UL, 7UL})
+        {
+            MagicalContainer unique;
+            unique.addElement(99999);
+            unique.build(values, {threads});
+            MagicalContainer unique_reference;
+            unique_reference.addElements(values);
+            CHECK(unique.getAscContainer() == unique_reference.getAscContainer());
+            CHECK(unique.primeCount() == unique_reference.primeCount());
+            CHECK(unique.primeIndex(10) == unique_reference.primeIndex(10));
+
+            BasicMagicalContainer<Duplicates::Multiset> multiset;
+            multiset.build(values, {threads});
+            BasicMagicalContainer<Duplicates::Multiset> multiset_reference;
+            multiset_reference.addElements(values);
+            CHECK(multiset.getAscContainer() == multiset_reference.getAscContainer());
+            CHECK(multiset.primeCount() == multiset_reference.primeCount());
+
+            BasicMagicalContainer<Duplicates::Counted> counted;
+            counted.build(values, {threads});
+            BasicMagicalContainer<Duplicates::Counted> counted_reference;
+            counted_reference.addElements(values);
+            CHECK(counted.getAscContainer() == counted_reference.getAscContainer());
+            CHECK(counted.totalCount() == values.size());
+            bool same_counts = true;
+            for (int value : counted.getAscContainer()) same_counts = same_counts && counted.count(value) == counted_reference.count(value);
+            CHECK(same_counts);
+        }
+    }
+
+    SUBCASE("build replaces the elements")
+    {
+        MagicalContainer container;
+        container.addElements(std::vector<int>{1, 2, 3});
+        auto it = container.begin();
+        container.build(std::vector<int>{7, 5, 5}, {2});
+        CHECK(container.getAscContainer() == std::vector<int>{5, 7});
+        CHECK(container.primeCount() == 2);
+        if constexpr (CHECKED_ITERATORS) CHECK_THROWS_AS(*it, std::runtime_error);
+        container.build(std::vector<int>{}, {4});
+        CHECK(container.size() == 0);
+        CHECK(container.primeCount() == 0);
+    }
+}
+
+TEST_CASE("parallel traversal")
+{
+    MagicalContainer container;
+    std::vector<int> values;
+    for (int value = -50; value < 30000; value += 3) values.push_back(value);
+    container.addElements(values);
+
+    auto sequentialSum = [](auto view) {
+        long long sum = 0;
+        for (int element : view) sum += element;
+        return sum;
+    };
+    auto sum = [](long long total, int element) { return total + element; };
+    auto add = [](long long left, long long right) { return left + right; };
+
+    for (std::size_t threads : {1UL, 3UL, 4UL})
+    {
+        ThreadPool pool(threads);
+        CHECK(pool.threadCount() == threads);
+
+        // reductions over every order
+        {
+            CHECK(parallelReduce(pool, container.ascending(), 0LL, sum, add) == sequentialSum(container.ascending()));
+            CHECK(parallelReduce(pool, container.sideCross(), 0LL, sum, add) == sequentialSum(container.sideCross()));
+            CHECK(parallelReduce(pool, container.primes(), 0LL, sum, add) == sequentialSum(container.primes()));
+            auto count = [](std::size_t total, int) { return total + 1; };
+            auto addCounts = [](std::size_t left, std::size_t right) { return left + right; };
+            CHECK(parallelReduce(pool, container.sideCross(), std::size_t{0}, count, addCounts) == container.size());
+            CHECK(parallelReduce(pool, container.primes(), std::size_t{0}, count, addCounts) == container.primeCount());
+            auto maximum = [](int left, int right) { return std::max(left, right); };
+            CHECK(parallelReduce(pool, container.sideCross(), INT_MIN, maximum, maximum) == values.back());
+        }
+
+        // for each visits every element once
+        {
+            std::vector<std::atomic<int>> visits(values.size());
+            parallelForEach(pool, container.sideCross(), [&](int element) { ++visits[static_cast<std::size_t>((element + 50) / 3)]; });
+            bool once = true;
+            for (auto &visit : visits) once = once && visit == 1;
+            CHECK(once);
+        }
+
+        // the pool runs every task and rethrows
+        {
+            std::vector<std::atomic<int>> runs(1000);
+            pool.run(runs.size(), [&](std::size_t task) { ++runs[task]; });
+            bool once = true;
+            for (auto &run : runs) once = once && run == 1;
+            CHECK(once);
+            CHECK_THROWS_AS(pool.run(10, [](std::size_t task) { if (task == 7) throw std::runtime_error("task failed"); }), std::runtime_error);
+            std::atomic<std::size_t> after = 0;
+            pool.run(5, [&](std::size_t) { ++after; });
+            CHECK(after == 5);
+        }
+
+        // runs from several threads at once take turns and each runs its own tasks
+        {
+            std::vector<std::atomic<int>> runs(4 * 500);
+            std::vector<std::thread> callers;
+            for (std::size_t caller = 0; caller < 4; ++caller)
+            {
+                callers.emplace_back([&, caller] {
+                    for (int round = 0; round < 5; ++round) pool.run(100, [&](std::size_t task) { ++runs[caller * 500 + static_cast<std::size_t>(round) * 100 + task]; });
+                });
+            }
+            for (auto &caller : callers) caller.join();
+            bool once = true;
+            for (auto &run : runs) once = once && run == 1;
+            CHECK(once);
+        }
+    }
+}
+
+TEST_CASE("staging")
+{
+    SUBCASE("ring")
+    {
+        StagingRing empty;
+        CHECK(empty.capacity() == 0);
+        CHECK_FALSE(empty.push(1));
+
+        StagingRing ring(5);
+        CHECK(ring.capacity() == 8);
+        for (int element = 0; element < 8; ++element) CHECK(ring.push(element));
+        CHECK_FALSE(ring.push(8));
+        CHECK(ring.size() == 8);
+        StagingRing copy(ring);
+        std::vector<int> out;
+        CHECK(ring.drain(out) == 8);
+        CHECK(out == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7});
+        CHECK(ring.empty());
+        CHECK(ring.push(8)); // the counters wrap around the slots
+        CHECK(ring.drain(out) == 1);
+        CHECK(out.back() == 8);
+        std::vector<int> copied;
+        CHECK(copy.drain(copied) == 8);
+        CHECK(copied.front() == 0);
+    }
+
+    SUBCASE("staged elements are merged before reads and changes")
+    {
+        MagicalContainer container;
+        container.addElements(std::vector<int>{1, 4, 9});
+        CHECK_FALSE(container.stageElement(5)); // no staging ring yet
+        container.reserveStaging(16);
+        CHECK(container.stageElement(11));
+        CHECK(container.stageElement(5));
+        CHECK(container.stageElement(4));
+        CHECK(container.stagedCount() == 3);
+        CHECK(container.size() == 3); // const queries see merged elements only
+
+        std::vector<int> ascending;
+        for (int element : container) ascending.push_back(element);
+        CHECK(ascending == std::vector<int>{1, 4, 5, 9, 11});
+        CHECK(container.stagedCount() == 0);
+        CHECK(container.primeCount() == 2);
+
+        container.stageElement(13);
+        container.removeElement(13); // the change sees the staged element
+        CHECK_FALSE(container.contains(13));
+        container.stageElement(2);
+        CHECK(container.sideCross().begin()[1] == 11);
+        container.stageElement(3);
+        CHECK(container.mergeStaged() == 1);
+        CHECK(container.mergeStaged() == 0);
+        CHECK(*container.primes().begin() == 2);
+    }
+
+    SUBCASE("iterators merge staged elements, const queries and end do not")
+    {
+        MagicalContainer container;
+        container.reserveStaging(16);
+        auto staged = [&](std::initializer_list<int> elements) {
+            for (int element : elements) CHECK(container.stageElement(element));
+        };
+
+        staged({8, 3});
+        MagicalContainer::AscendingIterator asc_itr(container);
+        CHECK(container.stagedCount() == 0);
+        staged({5});
+        std::vector<int> ascending;
+        for (auto itr = asc_itr.begin(); itr != asc_itr.end(); ++itr) ascending.push_back(*itr);
+        CHECK(ascending == std::vector<int>{3, 5, 8});
+
+        // elements staged during a walk wait for the next begin, end never merges them
+        ascending.clear();
+        for (auto itr = asc_itr.begin(); itr != asc_itr.end(); ++itr)
+        {
+            ascending.push_back(*itr);
+            if (*itr == 3) staged({20, 30});
+        }
+        CHECK(ascending == std::vector<int>{3, 5, 8});
+        CHECK(container.stagedCount() == 2);
+        std::vector<int> crossed;
+        MagicalContainer::SideCrossIterator cross_itr(container);
+        for (auto itr = cross_itr.begin(); itr != cross_itr.end(); ++itr)
+        {
+            crossed.push_back(*itr);
+            if (crossed.size() == 1) staged({1});
+        }
+        CHECK(crossed == std::vector<int>{3, 30, 5, 20, 8});
+        std::vector<int> primes;
+        MagicalContainer::PrimeIterator prime_itr(container);
+        for (auto itr = prime_itr.begin(); itr != prime_itr.end(); ++itr)
+        {
+            primes.push_back(*itr);
+            if (primes.size() == 1) staged({7});
+        }
+        CHECK(primes == std::vector<int>{3, 5});
+
+        // const queries see the merged elements only, until a non const call merges
+        CHECK(container.stagedCount() == 1);
+        CHECK_FALSE(container.contains(7));
+        CHECK(container.size() == 6);
+        const MagicalContainer copy(container);
+        CHECK(copy.stagedCount() == 1);
+        CHECK(copy.size() == 6);
+        CHECK(container.mergeStaged() == 1);
+        CHECK(container.contains(7));
+        CHECK(container.primesBefore(8) == 3);
+    }
+
+    SUBCASE("a producer stages while the owner merges")
+    {
+        BasicMagicalContainer<Duplicates::Multiset> container;
+        container.reserveStaging(256);
+        const int total = 50000;
+        std::thread producer([&] {
+            for (int element = 0; element < total; ++element)
+            {
+                while (!container.stageElement(element + (element % 7 == 0 ? -3 : 0))) std::this_thread::yield();
+            }
+        });
+        std::size_t merged = 0;
+        while (merged < static_cast<std::size_t>(total))
+        {
+            merged += container.mergeStaged();
+            std::this_thread::yield();
+        }
+        producer.join();
+        CHECK(container.size() == static_cast<std::size_t>(total));
+        CHECK(std::is_sorted(container.getAscContainer().begin(), container.getAscContainer().end()));
+    }
+}
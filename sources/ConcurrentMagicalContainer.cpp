@@ -0,0 +1,177 @@
+#include "ConcurrentMagicalContainer.hpp"
+namespace ariel
+{
+    namespace
+    {
+        // split values that cut [low, high) into shards ranges of equal width
+        std::vector<int> equalSplits(int low, int high, std::size_t shards)
+        {
+            if (shards == 0 || low >= high) throw std::invalid_argument("concurrent container needs at least one shard and a non empty range");
+            std::vector<int> splits;
+            long long width = (static_cast<long long>(high) - low) / static_cast<long long>(shards);
+            for (std::size_t i = 1; i < shards; ++i) splits.push_back(static_cast<int>(low + width * static_cast<long long>(i)));
+            return splits;
+        }
+    }
+
+//----------- ConcurrentMagicalContainer class ---------------------------------------
+    // **** define constructors ****
+    /**
+     * @brief default constructor, DEFAULT_SHARDS shards of equal width over the whole int range
+     */
+    template <Duplicates Policy>
+    BasicConcurrentMagicalContainer<Policy>::BasicConcurrentMagicalContainer(): BasicConcurrentMagicalContainer(INT_MIN, INT_MAX, DEFAULT_SHARDS) {}
+
+    /**
+     * @brief constructor with shards of equal width
+     * @param low smallest value of the first shard range, smaller values still go to the first shard
+     * @param high end of the last shard range, larger values still go to the last shard
+     * @param shards number of shards, at least one
+     */
+    template <Duplicates Policy>
+    BasicConcurrentMagicalContainer<Policy>::BasicConcurrentMagicalContainer(int low, int high, std::size_t shards): BasicConcurrentMagicalContainer(equalSplits(low, high, shards)) {}
+
+    /**
+     * @brief constructor with explicit shard boundaries
+     * @param splits sorted split values, shard i holds the values in [splits[i-1], splits[i])
+     */
+    template <Duplicates Policy>
+    BasicConcurrentMagicalContainer<Policy>::BasicConcurrentMagicalContainer(std::vector<int> splits): splits_(std::move(splits))
+    {
+        if (!std::is_sorted(splits_.begin(), splits_.end())) throw std::invalid_argument("shard splits must be sorted");
+        for (std::size_t i = 0; i <= splits_.size(); ++i) shards_.push_back(std::make_unique<Shard>());
+    }
+
+    // **** define function ****
+    /**
+     * @brief find the shard of an element with a binary search over the splits
+     * @param element value to place
+     * @return index of the shard whose range holds element
+     */
+    template <Duplicates Policy>
+    std::size_t BasicConcurrentMagicalContainer<Policy>::shardIndex(int element) const
+    {
+        return static_cast<std::size_t>(std::upper_bound(splits_.begin(), splits_.end(), element) - splits_.begin());
+    }
+
+    /**
+     * @brief shard of an element
+     * @param element value to place
+     * @return reference to the shard whose range holds element
+     */
+    template <Duplicates Policy>
+    typename BasicConcurrentMagicalContainer<Policy>::Shard& BasicConcurrentMagicalContainer<Policy>::shardOf_(int element) const
+    {
+        return *shards_[shardIndex(element)];
+    }
+
+    /**
+     * @brief lock every shard shared. locks are taken in shard order and writers only ever hold one, so there is
+     * no lock order cycle
+     * @return the held locks, released when destroyed
+     */
+    template <Duplicates Policy>
+    std::vector<std::shared_lock<std::shared_mutex>> BasicConcurrentMagicalContainer<Policy>::lockAll_() const
+    {
+        std::vector<std::shared_lock<std::shared_mutex>> locks;
+        locks.reserve(shards_.size());
+        for (const auto &shard : shards_) locks.emplace_back(shard->mutex);
+        return locks;
+    }
+
+    /**
+     * @brief merge buckets of elements into their shards with one batch insert and one lock per shard
+     * @param buckets elements of every shard, in shard order
+     */
+    template <Duplicates Policy>
+    void BasicConcurrentMagicalContainer<Policy>::addBuckets_(std::vector<std::vector<int>> &buckets)
+    {
+        for (std::size_t i = 0; i < buckets.size(); ++i)
+        {
+            if (buckets[i].empty()) continue;
+            std::unique_lock lock(shards_[i]->mutex);
+            shards_[i]->container.addElements(buckets[i]);
+        }
+    }
+
+    /**
+     * @brief add element to its shard under the shard exclusive lock
+     * @param element element to add
+     */
+    template <Duplicates Policy>
+    void BasicConcurrentMagicalContainer<Policy>::addElement(int element)
+    {
+        Shard &shard = shardOf_(element);
+        std::unique_lock lock(shard.mutex);
+        shard.container.addElement(element);
+    }
+
+    /**
+     * @brief remove element from its shard under the shard exclusive lock
+     * @param element element to remove, throws if it is not in the container
+     */
+    template <Duplicates Policy>
+    void BasicConcurrentMagicalContainer<Policy>::removeElement(int element)
+    {
+        Shard &shard = shardOf_(element);
+        std::unique_lock lock(shard.mutex);
+        shard.container.removeElement(element);
+    }
+
+    /**
+     * @brief check if element is in the container under the shard shared lock
+     * @param element element to look for
+     * @return bool that indicated if element is in the container
+     */
+    template <Duplicates Policy>
+    bool BasicConcurrentMagicalContainer<Policy>::contains(int element) const
+    {
+        Shard &shard = shardOf_(element);
+        std::shared_lock lock(shard.mutex);
+        return shard.container.contains(element);
+    }
+
+    /**
+     * @brief count the copies of element under the shard shared lock
+     * @param element element to count
+     * @return number of times element is in the container
+     */
+    template <Duplicates Policy>
+    std::size_t BasicConcurrentMagicalContainer<Policy>::count(int element) const
+    {
+        Shard &shard = shardOf_(element);
+        std::shared_lock lock(shard.mutex);
+        return shard.container.count(element);
+    }
+
+    /**
+     * @brief number of elements, every shard is locked shared together so the sum is consistent
+     * @return number of elements added and not removed
+     */
+    template <Duplicates Policy>
+    std::size_t BasicConcurrentMagicalContainer<Policy>::size() const
+    {
+        auto locks = lockAll_();
+        std::size_t total = 0;
+        for (const auto &shard : shards_) total += shard->container.size();
+        return total;
+    }
+
+    /**
+     * @brief number of prime elements, every shard is locked shared together so the sum is consistent
+     * @return number of prime elements
+     */
+    template <Duplicates Policy>
+    std::size_t BasicConcurrentMagicalContainer<Policy>::primeCount() const
+    {
+        auto locks = lockAll_();
+        std::size_t total = 0;
+        for (const auto &shard : shards_) total += shard->container.primeCount();
+        return total;
+    }
+
+    // every duplicate policy is compiled here
+    template class BasicConcurrentMagicalContainer<Duplicates::Unique>;
+    template class BasicConcurrentMagicalContainer<Duplicates::Multiset>;
+    template class BasicConcurrentMagicalContainer<Duplicates::Counted>;
+}
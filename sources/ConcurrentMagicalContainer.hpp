@@ -0,0 +1,117 @@
+#pragma once
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include "MagicalContainer.hpp"
+
+namespace ariel {
+//----------- ConcurrentMagicalContainer class ---------------------------------------
+    // thread safe container. the value space is split into range shards, every shard is a container with its own
+    // reader writer lock, so writers to different ranges and readers never wait on one global lock.
+    // the three orders are stitched across the shards
+    template <Duplicates Policy = Duplicates::Unique>
+    class BasicConcurrentMagicalContainer
+    {
+    public:
+        static constexpr std::size_t DEFAULT_SHARDS = 16; // shards of the default constructor
+
+    private:
+        // one range of the value space
+        struct Shard
+        {
+            mutable std::shared_mutex mutex; // shared by readers, exclusive for writers
+            BasicMagicalContainer<Policy> container; // elements of the range
+        };
+
+        // **** declare attributes ****
+        std::vector<int> splits_; // shard i holds the values in [splits_[i-1], splits_[i]), the first and last shards are open ended
+        std::vector<std::unique_ptr<Shard>> shards_; // one more shard than splits
+
+        Shard& shardOf_(int element) const; // shard whose range holds element
+        std::vector<std::shared_lock<std::shared_mutex>> lockAll_() const; // shared lock on every shard, in shard order
+        void addBuckets_(std::vector<std::vector<int>> &buckets); // merge every bucket into its shard, one lock per shard
+
+    public:
+        // **** declare constructors ****
+        BasicConcurrentMagicalContainer(); // DEFAULT_SHARDS shards over the whole int range
+        BasicConcurrentMagicalContainer(int low, int high, std::size_t shards); // shards of equal width over [low, high), values outside go to the end shards
+        explicit BasicConcurrentMagicalContainer(std::vector<int> splits); // shard boundaries given as sorted split values
+
+        // **** declare & define getters ****
+        std::size_t shardCount() const {return shards_.size();} // return the number of shards
+        const std::vector<int>& splits() const {return splits_;} // return the shard boundaries
+
+        // **** declare functions ****
+        void addElement(int element); // add element, locks one shard
+        void removeElement(int element); // remove element, locks one shard
+        void addElements(std::ranges::input_range auto &&elements) // add every element of a range, every shard is locked once
+        {
+            std::vector<std::vector<int>> buckets(shards_.size());
+            for (auto &&element : elements) buckets[shardIndex(static_cast<int>(element))].push_back(static_cast<int>(element));
+            addBuckets_(buckets);
+        }
+        bool contains(int element) const; // check if element is in the container, locks one shard shared
+        std::size_t count(int element) const; // return how many times element is in the container
+        std::size_t size() const; // return the number of elements, every shard is read under one set of shared locks
+        std::size_t primeCount() const; // return the number of prime elements
+        std::size_t shardIndex(int element) const; // return the index of the shard whose range holds element
+
+        // **** declare & define traversals ****
+        template <class Visitor>
+        void forEachAscending(Visitor visit) const // visit every element in ascending order, one shard locked shared at a time
+        {
+            for (const auto &shard : shards_)
+            {
+                std::shared_lock lock(shard->mutex);
+                for (int element : shard->container.ascView()) visit(element);
+            }
+        }
+
+        template <class Visitor>
+        void forEachPrime(Visitor visit) const // visit every prime element in ascending order, one shard locked shared at a time
+        {
+            for (const auto &shard : shards_)
+            {
+                std::shared_lock lock(shard->mutex);
+                std::span<const int> elements = shard->container.ascView();
+                const RankSelect &bits = shard->container.primeBits();
+                for (std::size_t index = bits.nextOne(0); index < elements.size(); index = bits.nextOne(index + 1)) visit(elements[index]);
+            }
+        }
+
+        template <class Visitor>
+        void forEachSideCross(Visitor visit) const // visit every element in side cross order, every shard locked shared since both ends are read
+        {
+            auto locks = lockAll_();
+            std::vector<std::span<const int>> parts;
+            std::size_t total = 0;
+            for (const auto &shard : shards_)
+            {
+                parts.push_back(shard->container.ascView());
+                total += parts.back().size();
+            }
+
+            // a front cursor walks the shards up and a back cursor walks them down
+            std::size_t front_part = 0;
+            std::size_t front = 0;
+            std::size_t back_part = parts.size() - 1;
+            std::size_t back = parts[back_part].size();
+            for (std::size_t position = 0; position < total; ++position)
+            {
+                if ((position & 1U) == 0)
+                {
+                    while (front == parts[front_part].size()) {++front_part; front = 0;}
+                    visit(parts[front_part][front++]);
+                }
+                else
+                {
+                    while (back == 0) back = parts[--back_part].size();
+                    visit(parts[back_part][--back]);
+                }
+            }
+        }
+    };
+
+    using ConcurrentMagicalContainer = BasicConcurrentMagicalContainer<>; // concurrent container of unique elements
+}
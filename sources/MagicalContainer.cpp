@@ -1,22 +1,41 @@
 #include "MagicalContainer.hpp"
 namespace ariel
 {
+    namespace
+    {
+        // collapse runs of equal elements of a sorted vector, return the length of every run
+        std::vector<std::uint32_t> runLengths(std::vector<int> &sorted)
+        {
+            std::vector<std::uint32_t> counts;
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < sorted.size(); ++i)
+            {
+                if (kept > 0 && sorted[kept - 1] == sorted[i])
+                {
+                    ++counts.back();
+                    continue;
+                }
+                sorted[kept++] = sorted[i];
+                counts.push_back(1);
+            }
+            sorted.resize(kept);
+            return counts;
+        }
+    }
+
 //----------- MagicalContainer class ---------------------------------------
     // **** define constructors ****
     /**
      * @brief default constructor
      */
-    MagicalContainer::MagicalContainer() {}
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::BasicMagicalContainer() {}
      /**
-      * @brief copy constructor
+      * @brief copy constructor. the prime view holds indices, so a member wise copy is valid as is
       * @param other reference to another MagicalContainer
       */
-      MagicalContainer::MagicalContainer(ariel::MagicalContainer &other)
-      {
-          this->container_ = other.getContainer();
-          this->asc_container_ = other.getAscContainer();
-          this->prime_container_ = other.getPrimeContainer();
-      }
+      template <Duplicates Policy>
+      BasicMagicalContainer<Policy>::BasicMagicalContainer(const BasicMagicalContainer &other) = default;
 
       // **** define function ****
       /**
@@ -24,115 +43,428 @@ namespace ariel
        * @param element number
        * @return bool that indicated if number is prime
        */
-      bool MagicalContainer::isPrime_(int element)
+      template <Duplicates Policy>
+      bool BasicMagicalContainer<Policy>::isPrime_(int element)
       {
-          if (element < 2) return false; // non prime
-          if (element == 2) return true; // prime
-
-          for (int i=2; i*i<=element; i++)
-          {
-              if (element % i == 0) return false; // optional divisor exist, non prime
-          }
-          return true; // no optional divisor, element is prime
+          return sieve_.isPrime(element);
       }
 
       /**
        * @brief function to add element to sorted container
        * @param element element to be added
+       * @return index of the element in the sorted container
+       */
+      template <Duplicates Policy>
+      std::size_t BasicMagicalContainer<Policy>::addSortedElement_(int element)
+      {
+          // binary search the insertion point, then shift the tail once (upper bound keeps equal elements in insert order)
+          auto position = std::upper_bound(asc_container_.begin(), asc_container_.end(), element);
+          auto index = static_cast<std::size_t>(position - asc_container_.begin());
+          asc_container_.insert(position, element);
+          markChanged_(std::span<const int>(&element, 1));
+          version_ = newToken_();
+          return index;
+      }
+    /**
+     * @brief insert the element prime bit at its sorted index, the bits behind it move with their elements
+     * @param element element that was added to the sorted container
+     * @param index index of the element in the sorted container
+     */
+    template <Duplicates Policy>
+    void BasicMagicalContainer<Policy>::addPrimeElement_(int element, std::size_t index)
+    {
+        prime_bits_.insert(index, isPrime_(element));
+    }
+      /**
+       * @brief function add element to all containers. an element already in the container is ignored (Unique),
+       * stored again (Multiset) or counted (Counted)
+       * @param element int number that will be added
        */
-      void MagicalContainer::addSortedElement_(int element)
+      template <Duplicates Policy>
+      void BasicMagicalContainer<Policy>::addElement(int element)
       {
-          asc_container_.push_back(element); // add element to end of container
-          for (std::size_t i = asc_container_.size()-1; i>0; --i) // sort container from end to beginning
+          mergeIfStaged_();
+          if constexpr (Policy == Duplicates::Unique)
           {
-              // swap if element at index i-1 is bigger than element at index i
-              if(asc_container_.at(i-1) > asc_container_.at(i)) swap(asc_container_.at(i-1), asc_container_.at(i));
+              if (contains(element)) return; // elements are unique
           }
+          else if constexpr (Policy == Duplicates::Counted)
+          {
+              ++count_total_;
+              auto position = std::lower_bound(asc_container_.begin(), asc_container_.end(), element);
+              if (position != asc_container_.end() && *position == element) // already stored, count it
+              {
+                  ++counts_[static_cast<std::size_t>(position - asc_container_.begin())];
+                  return;
+              }
+          }
+          std::size_t index = this->addSortedElement_(element); // add element to sorted container
+          if constexpr (Policy == Duplicates::Counted) counts_.insert(counts_.begin() + static_cast<std::ptrdiff_t>(index), 1);
+          this->addPrimeElement_(element, index); // add element index to primeContainer if element is prime
       }
+
     /**
-     * @brief update primeContainer elements address
+     * @brief add a batch of elements. the batch is sorted (and deduped or counted), classified in one sieve pass,
+     * merged into the sorted container in one linear pass and the prime bits are indexed once. elements smaller than
+     * the smallest batch element keep their place, so only the tail from there on is merged and near sorted batches
+     * that land at the end cost O(batch)
+     * @param batch elements to be added, duplicates follow the container policy
      */
-    void MagicalContainer::updatePrimeAddress_()
+    template <Duplicates Policy>
+    void BasicMagicalContainer<Policy>::addBatch_(std::vector<int> batch)
     {
-        // update prime numbersContainer addresses after insertion
-        std::size_t j=0;
-        for (std::size_t i = 0; i < asc_container_.size()-1; ++i)
+        if (batch.empty()) return;
+        std::sort(batch.begin(), batch.end());
+        std::vector<std::uint32_t> batch_counts;
+        if constexpr (Policy == Duplicates::Unique) batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+        if constexpr (Policy == Duplicates::Counted)
+        {
+            count_total_ += batch.size();
+            batch_counts = runLengths(batch);
+        }
+
+        std::vector<bool> batch_flags;
+        sieve_.classify(batch, batch_flags);
+        markChanged_(batch);
+
+        // linear merge of the tail of the sorted container and the batch, flags and counts travel with their elements
+        auto first = static_cast<std::size_t>(std::lower_bound(asc_container_.begin(), asc_container_.end(), batch.front()) - asc_container_.begin());
+        std::vector<int> merged;
+        std::vector<bool> merged_flags;
+        std::vector<std::uint32_t> merged_counts;
+        merged.reserve(asc_container_.size() - first + batch.size());
+        merged_flags.reserve(asc_container_.size() - first + batch.size());
+        if constexpr (Policy == Duplicates::Counted) merged_counts.reserve(asc_container_.size() - first + batch.size());
+        std::size_t i = first;
+        std::size_t j = 0;
+        while (i < asc_container_.size() || j < batch.size())
         {
-            if (isPrime_(asc_container_.at(i)))
+            if (j == batch.size() || (i < asc_container_.size() && asc_container_[i] <= batch[j]))
             {
-                prime_container_.at(j++) = &asc_container_.at(i);
+                bool stored = j < batch.size() && asc_container_[i] == batch[j];
+                if constexpr (Policy == Duplicates::Unique)
+                {
+                    if (stored) ++j; // already in the container
+                }
+                else if constexpr (Policy == Duplicates::Counted)
+                {
+                    merged_counts.push_back(counts_[i] + (stored ? batch_counts[j++] : 0));
+                }
+                merged.push_back(asc_container_[i]);
+                merged_flags.push_back(prime_bits_.test(i++));
             }
+            else
+            {
+                if constexpr (Policy == Duplicates::Counted) merged_counts.push_back(batch_counts[j]);
+                merged.push_back(batch[j]);
+                merged_flags.push_back(batch_flags[j++]);
+            }
+        }
+
+        asc_container_.resize(first);
+        asc_container_.insert(asc_container_.end(), merged.begin(), merged.end());
+        prime_bits_.resize(first);
+        prime_bits_.reserve(asc_container_.size());
+        for (bool flag : merged_flags) prime_bits_.pushBack(flag);
+        prime_bits_.build();
+        if constexpr (Policy == Duplicates::Counted)
+        {
+            counts_.resize(first);
+            counts_.insert(counts_.end(), merged_counts.begin(), merged_counts.end());
         }
+        version_ = newToken_();
     }
+
     /**
-     * @brief add element address to primeContainer if element is prime. then sort primeContainer if needed
-     * @param element
+     * @brief remove a batch of elements. the batch is sorted (and deduped or counted), then the sorted container and
+     * the prime bits are compacted in one linear pass and indexed once.
+     * with Multiset and Counted every copy in the batch removes one stored copy
+     * @param batch elements to be removed
+     * @param policy what to do with elements of the batch that are not in the container
+     * @return the missing elements in ascending order when policy is Report, otherwise empty
      */
-    void MagicalContainer::addPrimeElement_(int element)
+    template <Duplicates Policy>
+    std::vector<int> BasicMagicalContainer<Policy>::removeBatch_(std::vector<int> batch, MissingElements policy)
     {
-        if (isPrime_(element))
+        std::sort(batch.begin(), batch.end());
+        if constexpr (Policy == Duplicates::Unique) batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+
+        // find the missing elements first so a throw leaves the container untouched
+        std::vector<int> missing;
+        std::vector<std::uint32_t> batch_counts;
+        if constexpr (Policy == Duplicates::Counted)
         {
-            prime_container_.push_back(&asc_container_.back());
+            batch_counts = runLengths(batch);
+            for (std::size_t j = 0; j < batch.size(); ++j)
+            {
+                std::uint32_t stored = static_cast<std::uint32_t>(count(batch[j]));
+                if (batch_counts[j] > stored) missing.insert(missing.end(), batch_counts[j] - stored, batch[j]);
+            }
         }
-        updatePrimeAddress_();
+        else
+        {
+            std::set_difference(batch.begin(), batch.end(), asc_container_.begin(), asc_container_.end(), std::back_inserter(missing));
+        }
+        if (policy == MissingElements::Throw && !missing.empty()) throw std::runtime_error("cant remove non-existing element");
+
+        // compact in place, elements found in the batch are dropped together with their flags and counts
+        std::size_t kept = 0;
+        std::size_t j = 0;
+        for (std::size_t i = 0; i < asc_container_.size(); ++i)
+        {
+            while (j < batch.size() && batch[j] < asc_container_[i]) ++j;
+            if (j < batch.size() && batch[j] == asc_container_[i])
+            {
+                if constexpr (Policy == Duplicates::Counted)
+                {
+                    std::uint32_t removed = std::min(counts_[i], batch_counts[j++]);
+                    count_total_ -= removed;
+                    counts_[i] -= removed;
+                    if (counts_[i] > 0)
+                    {
+                        counts_[kept] = counts_[i];
+                        asc_container_[kept] = asc_container_[i];
+                        prime_bits_.set(kept++, prime_bits_.test(i));
+                    }
+                }
+                else
+                {
+                    ++j;
+                }
+                continue;
+            }
+            if constexpr (Policy == Duplicates::Counted) counts_[kept] = counts_[i];
+            asc_container_[kept] = asc_container_[i];
+            prime_bits_.set(kept++, prime_bits_.test(i));
+        }
+        if (kept < asc_container_.size())
+        {
+            markChanged_(batch);
+            epoch_ = newToken_();
+        }
+        asc_container_.resize(kept);
+        prime_bits_.resize(kept);
+        prime_bits_.build();
+        if constexpr (Policy == Duplicates::Counted) counts_.resize(kept);
+        version_ = newToken_();
+
+        if (policy != MissingElements::Report) missing.clear();
+        return missing;
     }
-      /**
-       * @brief function add element to all containers by
-       * @param element int number that will be added to set
-       */
-      void MagicalContainer::addElement(int element)
-      {
-          container_.insert(element); // add element to elements set
-          this->addSortedElement_(element); // add element to sorted container
-          this->addPrimeElement_(element); // add element address to primeContainer if element is prime
-      }
 
     /**
-     * @brief remove element if exist from sortedContainer
-     * @param element do be removed
+     * @brief replace the elements with an unsorted array. every phase runs on policy.threads threads: the array is
+     * sorted by slices and merged, the first element of every run of equal elements is counted per slice and a prefix
+     * sum of the counts gives every slice its output offset (Unique and Counted), and the prime bits are filled word
+     * by word from the sieve, which grows once for the largest element
+     * @param elements elements in any order, duplicates follow the container policy
+     * @param policy number of threads
      */
-    void MagicalContainer::removeSortedElement_(int element)
+    template <Duplicates Policy>
+    void BasicMagicalContainer<Policy>::build(std::span<const int> elements, ExecutionPolicy policy)
     {
-        // auto it = std::find(asc_container_.begin(), asc_container_.end(), element); // find the element iterator if exist
-        // for (auto itr = asc_container_.begin(); itr != asc_container_.end()
-        // {
+        mergeIfStaged_(); // staged elements are replaced like the stored ones
+        std::size_t threads = std::max<std::size_t>(policy.threads, 1);
+        std::vector<int> sorted(elements.begin(), elements.end());
+        parallelSort(sorted, threads);
+        std::size_t n = sorted.size();
+
+        std::vector<std::uint32_t> counts;
+        if constexpr (Policy != Duplicates::Multiset)
+        {
+            std::vector<std::size_t> offsets(threads + 1, 0);
+            auto runStart = [&](std::size_t i) {return i == 0 || sorted[i] != sorted[i - 1];};
+            parallelFor(threads, n, [&](std::size_t part, std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) if (runStart(i)) ++offsets[part + 1];
+            });
+            for (std::size_t part = 0; part < threads; ++part) offsets[part + 1] += offsets[part];
 
-        // })
-        
-        // check if iterator found, then delete from ascContainer
-        // if (it != asc_container_.end())
-        // {
-        //     asc_container_.erase(it);
-        // }
+            std::vector<int> unique(offsets[threads]);
+            if constexpr (Policy == Duplicates::Counted) counts.resize(offsets[threads]);
+            parallelFor(threads, n, [&](std::size_t part, std::size_t begin, std::size_t end) {
+                std::size_t kept = offsets[part];
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    if (!runStart(i)) continue;
+                    if constexpr (Policy == Duplicates::Counted)
+                    {
+                        std::size_t last = i + 1;
+                        while (last < n && sorted[last] == sorted[i]) ++last; // a run may end in the next slice
+                        counts[kept] = static_cast<std::uint32_t>(last - i);
+                    }
+                    unique[kept++] = sorted[i];
+                }
+            });
+            sorted = std::move(unique);
+            n = sorted.size();
+        }
+
+        // the largest element the sieve answers, the elements above its ceiling are tested with Miller-Rabin
+        auto sieved = std::upper_bound(sorted.begin(), sorted.end(), static_cast<std::int64_t>(sieve_.ceiling()), [](std::int64_t bound, int element) {return bound < element;});
+        if (sieved != sorted.begin()) sieve_.cover(*(sieved - 1));
+        std::vector<std::uint64_t> words((n + 63) / 64, 0);
+        parallelFor(threads, words.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t word = begin; word < end; ++word)
+            {
+                std::size_t last = std::min(n, (word + 1) * 64);
+                for (std::size_t i = word * 64; i < last; ++i) if (sieve_.lookup(sorted[i])) words[word] |= std::uint64_t{1} << (i & 63U);
+            }
+        });
+
+        asc_container_ = std::move(sorted);
+        prime_bits_.assign(std::move(words), n);
+        prime_bits_.build();
+        if constexpr (Policy == Duplicates::Counted)
+        {
+            counts_ = std::move(counts);
+            count_total_ = elements.size();
+        }
+        changed_.clear();
+        rebuilt_ = true;
+        epoch_ = newToken_();
+        version_ = newToken_();
     }
 
     /**
-     * @brief remove element from primeContainer
-     * @param element to be removed
+     * @brief record elements added to or removed from the sorted container since the last publish. nothing is
+     * recorded before the first publish, so a container that never publishes pays nothing. past MAX_TRACKED_CHANGES
+     * recording stops and the next publish copies everything
+     * @param elements the elements, in any order
      */
-    void MagicalContainer::removePrimeElement_(int element)
+    template <Duplicates Policy>
+    void BasicMagicalContainer<Policy>::markChanged_(std::span<const int> elements)
     {
-        // if element is prime remove one item from primeContainer
-        if (isPrime_(element))
+        if (rebuilt_) return;
+        if (changed_.size() + elements.size() > MAX_TRACKED_CHANGES)
         {
-            prime_container_.pop_back(); // remove last element
+            changed_.clear();
+            changed_.shrink_to_fit();
+            rebuilt_ = true;
+            return;
         }
-        // update prime elements addresses
-        updatePrimeAddress_();
+        changed_.insert(changed_.end(), elements.begin(), elements.end());
     }
 
     /**
-     * @brief function to erase element from all container if found
+     * @brief publish a snapshot of the current elements. chunks of the previous snapshot that no change since the
+     * last publish falls in are shared without being compared, so a publish after a few changes copies only the
+     * chunks around them. readers that still hold an older snapshot keep it alive until they drop it
+     * @return the new snapshot
+     */
+    template <Duplicates Policy>
+    std::shared_ptr<const MagicalSnapshot> BasicMagicalContainer<Policy>::publish()
+    {
+        mergeIfStaged_();
+        std::shared_ptr<const MagicalSnapshot> previous = published_.load();
+        std::sort(changed_.begin(), changed_.end());
+        auto snapshot = std::make_shared<const MagicalSnapshot>(asc_container_, prime_bits_, rebuilt_ ? nullptr : previous.get(), changed_);
+        published_.store(snapshot);
+        changed_.clear();
+        rebuilt_ = false;
+        return snapshot;
+    }
+
+    /**
+     * @brief a snapshot of the current elements. the last published snapshot is returned as is when no element was
+     * added or removed since, otherwise a new one is published first
+     * @return the snapshot
+     */
+    template <Duplicates Policy>
+    std::shared_ptr<const MagicalSnapshot> BasicMagicalContainer<Policy>::snapshot()
+    {
+        mergeIfStaged_();
+        std::shared_ptr<const MagicalSnapshot> snapshot = published_.load();
+        if (snapshot && changed_.empty() && !rebuilt_) return snapshot;
+        return publish();
+    }
+
+    /**
+     * @brief the latest published snapshot. it only reads the published slot, never the live containers, so it may
+     * run on any thread while the owning thread changes the container
+     * @return the snapshot, an empty one before the first publish
+     */
+    template <Duplicates Policy>
+    std::shared_ptr<const MagicalSnapshot> BasicMagicalContainer<Policy>::latestPublished() const
+    {
+        static const auto empty = std::make_shared<const MagicalSnapshot>();
+        std::shared_ptr<const MagicalSnapshot> snapshot = published_.load();
+        return snapshot ? snapshot : empty;
+    }
+
+    /**
+     * @brief replace the staging ring, the elements staged so far are merged first
+     * @param capacity number of elements the producer may stage between two merges, rounded up to a power of two
+     */
+    template <Duplicates Policy>
+    void BasicMagicalContainer<Policy>::reserveStaging(std::size_t capacity)
+    {
+        mergeIfStaged_();
+        staging_ = StagingRing(capacity);
+    }
+
+    /**
+     * @brief merge the staged elements into all containers as one batch. a near sorted producer stages elements
+     * that land at the end of the sorted container, so the merge only touches the tail
+     * @return number of staged elements merged
+     */
+    template <Duplicates Policy>
+    std::size_t BasicMagicalContainer<Policy>::mergeStaged()
+    {
+        std::vector<int> batch;
+        std::size_t staged = staging_.drain(batch);
+        addBatch_(std::move(batch));
+        return staged;
+    }
+
+    /**
+     * @brief remove element from sortedContainer, the caller checked it exists
+     * @param element do be removed
+     * @return index the element had in the sorted container
+     */
+    template <Duplicates Policy>
+    std::size_t BasicMagicalContainer<Policy>::removeSortedElement_(int element)
+    {
+        // binary search the element, then shift the tail once
+        auto position = std::lower_bound(asc_container_.begin(), asc_container_.end(), element);
+        auto index = static_cast<std::size_t>(position - asc_container_.begin());
+        asc_container_.erase(position);
+        markChanged_(std::span<const int>(&element, 1));
+        epoch_ = newToken_();
+        version_ = newToken_();
+        return index;
+    }
+
+    /**
+     * @brief remove the prime bit of the removed element, the bits behind it move with their elements
+     * @param index index the removed element had in the sorted container
+     */
+    template <Duplicates Policy>
+    void BasicMagicalContainer<Policy>::removePrimeElement_(std::size_t index)
+    {
+        prime_bits_.erase(index);
+    }
+
+    /**
+     * @brief function to erase element from all container if found. removes one copy with Multiset and Counted
      * @param element to be deleted
      */
-    void MagicalContainer::removeElement(int element)
+    template <Duplicates Policy>
+    void BasicMagicalContainer<Policy>::removeElement(int element)
     {
+        mergeIfStaged_();
         // check if element exist in containers. then remove it. else throw runtime error
-        if (container_.count(element) > 0) // element exit
+        if (contains(element)) // element exit
         {
-            container_.erase(element); // erase element from container
-            removeSortedElement_(element); // remove element from sortedContainer
-            removePrimeElement_(element); // remove element from primeContainer
+            if constexpr (Policy == Duplicates::Counted)
+            {
+                --count_total_;
+                auto position = std::lower_bound(asc_container_.begin(), asc_container_.end(), element);
+                auto count_position = counts_.begin() + (position - asc_container_.begin());
+                if (--*count_position > 0) return; // other copies left
+                counts_.erase(count_position);
+            }
+            std::size_t index = removeSortedElement_(element); // remove element from sortedContainer
+            removePrimeElement_(index); // remove element from primeContainer
         }
         else // element not exist
         {
@@ -140,42 +472,161 @@ namespace ariel
         }
     }
 
+    /**
+     * @brief count the copies of element
+     * @param element element to count
+     * @return number of times element is in the container
+     */
+    template <Duplicates Policy>
+    std::size_t BasicMagicalContainer<Policy>::count(int element) const
+    {
+        auto range = std::equal_range(asc_container_.begin(), asc_container_.end(), element);
+        if constexpr (Policy == Duplicates::Counted)
+        {
+            return range.first == range.second ? 0 : counts_[static_cast<std::size_t>(range.first - asc_container_.begin())];
+        }
+        else
+        {
+            return static_cast<std::size_t>(range.second - range.first);
+        }
+    }
+
 
 //----------- AscendingIterator class ---------------------------------------
 
     // **** define constructors ****
     /**
-     * @brief parameterized constructor
+     * @brief default constructor, the iterator is attached to a container on its first assignment
+     */
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::AscendingIterator::AscendingIterator(): container_(nullptr), index_(0), epoch_(0) {}
+
+    /**
+     * @brief parameterized constructor, the staged elements of the container are merged first
      * @param container reference for the magical container
      * @param index default=0. index for the iterator
      */
-    MagicalContainer::AscendingIterator::AscendingIterator(ariel::MagicalContainer &container, std::size_t index): container_(container), index_(index) {}
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::AscendingIterator::AscendingIterator(BasicMagicalContainer &container, std::size_t index): container_(&container), index_(index), epoch_(container.epoch_)
+    {
+        container.mergeIfStaged_(); // a merge only adds elements, the epoch stays
+    }
+
+    /**
+     * @brief iterator at index that does not merge the staged elements, so end can be called on every step of a walk
+     * without changing the elements under it
+     * @param container reference for the magical container
+     * @param index index for the iterator
+     * @param epoch container epoch of the iterator
+     */
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::AscendingIterator::AscendingIterator(BasicMagicalContainer &container, std::size_t index, std::size_t epoch): container_(&container), index_(index), epoch_(epoch) {}
 
     // **** define overload operators ****
     /**
-     * @brief overload dereference operator
-     * @return reference of element at index
+     * @brief overload member access operator, valid for every index up to end
+     * @return address of element at index
      */
-    int& MagicalContainer::AscendingIterator::operator*() {return container_.asc_container_.at(index_);}
+    template <Duplicates Policy>
+    int* BasicMagicalContainer<Policy>::AscendingIterator::operator->() const {return container_->asc_container_.data() + index_;}
+
+    /**
+     * @brief overload subscript operator
+     * @param offset distance from the iterator
+     * @return reference of element at index + offset
+     */
+    template <Duplicates Policy>
+    int& BasicMagicalContainer<Policy>::AscendingIterator::operator[](difference_type offset) const {return *(*this + offset);}
+
+    /**
+     * @brief overload the post ++ operator.
+     * @return iterator before increment
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator BasicMagicalContainer<Policy>::AscendingIterator::operator++(int)
+    {
+        AscendingIterator before = *this;
+        ++*this;
+        return before;
+    }
 
     /**
-     * @brief overload the ++ operator.
-     * @return iterator after increment
+     * @brief overload the post -- operator.
+     * @return iterator before decrement
      */
-    MagicalContainer::AscendingIterator& MagicalContainer::AscendingIterator::operator++()
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator BasicMagicalContainer<Policy>::AscendingIterator::operator--(int)
     {
-        // throw exception if increment over boundaries
-        if(end().index_ == index_) throw std::runtime_error("cant increment beyond boundaries");
-        ++index_;
+        AscendingIterator before = *this;
+        --*this;
+        return before;
+    }
+
+    /**
+     * @brief overload the += operator, jumps in O(1)
+     * @param offset distance to move, may be negative
+     * @return iterator after the move
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator& BasicMagicalContainer<Policy>::AscendingIterator::operator+=(difference_type offset)
+    {
+        index_ = static_cast<std::size_t>(static_cast<difference_type>(index_) + offset);
         return *this;
     }
 
+    /**
+     * @brief overload the -= operator, jumps in O(1)
+     * @param offset distance to move back, may be negative
+     * @return iterator after the move
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator& BasicMagicalContainer<Policy>::AscendingIterator::operator-=(difference_type offset)
+    {
+        return *this += -offset;
+    }
+
+    /**
+     * @brief overload the + operator
+     * @param offset distance from the iterator
+     * @return new iterator offset elements away
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator BasicMagicalContainer<Policy>::AscendingIterator::operator+(difference_type offset) const
+    {
+        AscendingIterator moved = *this;
+        return moved += offset;
+    }
+
+    /**
+     * @brief overload the - operator
+     * @param offset distance from the iterator
+     * @return new iterator offset elements back
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator BasicMagicalContainer<Policy>::AscendingIterator::operator-(difference_type offset) const
+    {
+        AscendingIterator moved = *this;
+        return moved -= offset;
+    }
+
+    /**
+     * @brief overload the distance operator
+     * @param other reference to another iterator
+     * @return number of elements from other to this iterator
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator::difference_type BasicMagicalContainer<Policy>::AscendingIterator::operator-(const AscendingIterator &other) const
+    {
+        return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+    }
+
     /**
      * @brief overload the equality operator
      * @param other reference to another iterator
      * @return bool that indicated if equality
      */
-    bool MagicalContainer::AscendingIterator::operator==(const MagicalContainer::AscendingIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::AscendingIterator::operator==(const AscendingIterator &other) const
     {
         return (index_ == other.index_);
     }
@@ -185,7 +636,8 @@ namespace ariel
      * @param other reference to another iterator
      * @return bool that indicated if inequality
      */
-    bool MagicalContainer::AscendingIterator::operator!=(const MagicalContainer::AscendingIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::AscendingIterator::operator!=(const AscendingIterator &other) const
     {
         return !(*this == other);
     }
@@ -195,7 +647,8 @@ namespace ariel
      * @param other reference for another iterator
      * @return bool that indicate comparison
      */
-    bool MagicalContainer::AscendingIterator::operator<(const MagicalContainer::AscendingIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::AscendingIterator::operator<(const AscendingIterator &other) const
     {
         return (this->index_ < other.index_);
     }
@@ -205,23 +658,40 @@ namespace ariel
      * @param other reference for another iterator
      * @return bool that indicate comparison
      */
-    bool MagicalContainer::AscendingIterator::operator>(const MagicalContainer::AscendingIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::AscendingIterator::operator>(const AscendingIterator &other) const
     {
         return (this->index_ > other.index_);
     }
 
+    /**
+     * @brief overload three way comparison, gives <= and >=
+     * @param other reference for another iterator
+     * @return ordering of the iterators positions
+     */
+    template <Duplicates Policy>
+    std::strong_ordering BasicMagicalContainer<Policy>::AscendingIterator::operator<=>(const AscendingIterator &other) const
+    {
+        return this->index_ <=> other.index_;
+    }
+
     /**
      * @brief assign iterator overload
      * @param other reference for another itertator
      * @return
      */
-    MagicalContainer::AscendingIterator& MagicalContainer::AscendingIterator::operator=(const MagicalContainer::AscendingIterator &other)
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator& BasicMagicalContainer<Policy>::AscendingIterator::operator=(const AscendingIterator &other)
     {
-        // check if containers are equal
-        if (container_.container_ != other.container_.container_) throw std::runtime_error("cant assign iterator on different container");
+        // a default constructed iterator takes the container of other
+        if (container_ == nullptr) container_ = other.container_;
+
+        // check if both iterators belong to the same container, by address
+        if (container_ != other.container_) throw std::runtime_error("cant assign iterator on different container");
 
-        // containers are equal so assign index
+        // same container so assign index
         index_ = other.index_;
+        epoch_ = other.epoch_;
         return *this;
     }
 
@@ -230,69 +700,166 @@ namespace ariel
      * @brief set iterator index at zero
      * @return the iterator after set index at 0
      */
-    MagicalContainer::AscendingIterator MagicalContainer::AscendingIterator::begin() const
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator BasicMagicalContainer<Policy>::AscendingIterator::begin() const
     {
-        return MagicalContainer::AscendingIterator(this->container_);
+        return AscendingIterator(*this->container_);
     }
 
     /**
      * set iterator index at end of the container
      * @return
      */
-    MagicalContainer::AscendingIterator MagicalContainer::AscendingIterator::end() const
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::AscendingIterator BasicMagicalContainer<Policy>::AscendingIterator::end() const
     {
-        return MagicalContainer::AscendingIterator(this->container_, this->container_.getAscContainer().size());
+        return AscendingIterator(*this->container_, this->container_->asc_container_.size(), this->container_->epoch_);
+    }
+
+    /**
+     * @brief copy the next elements in ascending order with one memcpy and advance the iterator past them
+     * @param out buffer to fill
+     * @return number of elements copied, less than out size only at the end of the container
+     */
+    template <Duplicates Policy>
+    std::size_t BasicMagicalContainer<Policy>::AscendingIterator::nextBatch(std::span<int> out)
+    {
+        container_->checkEpoch_(epoch_);
+        std::size_t count = std::min(out.size(), container_->asc_container_.size() - index_);
+        std::copy_n(container_->asc_container_.data() + index_, count, out.data());
+        index_ += count;
+        return count;
     }
 
 //----------- SideCrossIterator class ---------------------------------------
     // **** define constructors ****
     /**
-     * @brief SideCrossIterator parameterized constructor
+     * @brief default constructor, the iterator is attached to a container on its first assignment
+     */
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::SideCrossIterator::SideCrossIterator(): container_(nullptr), position_(0), epoch_(0) {}
+
+    /**
+     * @brief SideCrossIterator parameterized constructor, the staged elements of the container are merged first
      * @param container reference for the magical container
-     * @param index index of the iterator. default 0
+     * @param position position of the iterator in cross order. default 0
      */
-    MagicalContainer::SideCrossIterator::SideCrossIterator(ariel::MagicalContainer& container, std::size_t index): container_(container), index_(index) {}
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::SideCrossIterator::SideCrossIterator(BasicMagicalContainer& container, std::size_t position): container_(&container), position_(position), epoch_(container.epoch_)
+    {
+        container.mergeIfStaged_(); // a merge only adds elements, the epoch stays
+    }
+
+    /**
+     * @brief iterator at position that does not merge the staged elements, so end can be called on every step of a
+     * walk without changing the elements under it
+     * @param container reference for the magical container
+     * @param position position of the iterator in cross order
+     * @param epoch container epoch of the iterator
+     */
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::SideCrossIterator::SideCrossIterator(BasicMagicalContainer& container, std::size_t position, std::size_t epoch): container_(&container), position_(position), epoch_(epoch) {}
 
     // **** define overload operators ***
     /**
-     * @brief dereference overload operator
-     * @return element reference at index
+     * @brief increment the iterator. overload ++ post operator
+     * @return iterator before increment
      */
-    int& MagicalContainer::SideCrossIterator::operator*() {return container_.asc_container_.at(index_);}
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator BasicMagicalContainer<Policy>::SideCrossIterator::operator++(int)
+    {
+        SideCrossIterator before = *this;
+        ++*this;
+        return before;
+    }
 
     /**
-     * @brief increment the iterator. overload ++ pre operator
-     * @return iterator after increment
+     * @brief overload the post -- operator
+     * @return iterator before decrement
      */
-    MagicalContainer::SideCrossIterator& MagicalContainer::SideCrossIterator::operator++()
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator BasicMagicalContainer<Policy>::SideCrossIterator::operator--(int)
     {
-        // throw exception if increment over boundaries
-        if(end().index_ == index_) throw std::runtime_error("cant increment beyond boundaries");
+        SideCrossIterator before = *this;
+        --*this;
+        return before;
+    }
 
-        std::size_t mid_index = container_.getAscContainer().size()/2;
-        if (mid_index == index_) // if mid_index equal to index icrement to end index
-        {
-            index_ = container_.getAscContainer().size();
-        }
-        else if (index_<mid_index) // if index is on the left side from mid_index
-        {
-            index_ = (container_.getAscContainer().size()-1) - index_;
-        }
-        else if (index_ > mid_index) // if index is on the right side from mid_index
-        {
-            index_ = (container_.getAscContainer().size()) - index_;
-        }
+    /**
+     * @brief overload subscript operator
+     * @param offset distance from the iterator in cross order
+     * @return reference of element offset positions away
+     */
+    template <Duplicates Policy>
+    int& BasicMagicalContainer<Policy>::SideCrossIterator::operator[](difference_type offset) const {return *(*this + offset);}
+
+    /**
+     * @brief overload the += operator, jumps in O(1) since every position maps straight to an asc index
+     * @param offset distance to move, may be negative
+     * @return iterator after the move
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator& BasicMagicalContainer<Policy>::SideCrossIterator::operator+=(difference_type offset)
+    {
+        position_ = static_cast<std::size_t>(static_cast<difference_type>(position_) + offset);
         return *this;
     }
 
+    /**
+     * @brief overload the -= operator, jumps in O(1)
+     * @param offset distance to move back, may be negative
+     * @return iterator after the move
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator& BasicMagicalContainer<Policy>::SideCrossIterator::operator-=(difference_type offset)
+    {
+        return *this += -offset;
+    }
+
+    /**
+     * @brief overload the + operator
+     * @param offset distance from the iterator
+     * @return new iterator offset positions away
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator BasicMagicalContainer<Policy>::SideCrossIterator::operator+(difference_type offset) const
+    {
+        SideCrossIterator moved = *this;
+        return moved += offset;
+    }
+
+    /**
+     * @brief overload the - operator
+     * @param offset distance from the iterator
+     * @return new iterator offset positions back
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator BasicMagicalContainer<Policy>::SideCrossIterator::operator-(difference_type offset) const
+    {
+        SideCrossIterator moved = *this;
+        return moved -= offset;
+    }
+
+    /**
+     * @brief overload the distance operator
+     * @param other reference to another iterator
+     * @return number of positions from other to this iterator
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator::difference_type BasicMagicalContainer<Policy>::SideCrossIterator::operator-(const SideCrossIterator &other) const
+    {
+        return static_cast<difference_type>(position_) - static_cast<difference_type>(other.position_);
+    }
+
      /**
      * @brief overload the equality operator
      * @param other reference to another iterator
      * @return bool that indicated if equality
      */
-    bool MagicalContainer::SideCrossIterator::operator==(const MagicalContainer::SideCrossIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::SideCrossIterator::operator==(const SideCrossIterator &other) const
     {
-        return (index_ == other.index_);
+        return (position_ == other.position_);
     }
 
     /**
@@ -300,7 +867,8 @@ namespace ariel
     * @param other reference to another iterator
     * @return bool that indicated if inequality
     */
-    bool MagicalContainer::SideCrossIterator::operator!=(const MagicalContainer::SideCrossIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::SideCrossIterator::operator!=(const SideCrossIterator &other) const
     {
         return (!(*this == other));
     }
@@ -310,9 +878,10 @@ namespace ariel
      * @param other reference for another iterator
      * @return bool that indicate comparison
      */
-    bool MagicalContainer::SideCrossIterator::operator<(const MagicalContainer::SideCrossIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::SideCrossIterator::operator<(const SideCrossIterator &other) const
     {
-        return (this->index_ < other.index_);
+        return (this->position_ < other.position_);
     }
 
     /**
@@ -320,9 +889,21 @@ namespace ariel
      * @param other reference for another iterator
      * @return bool that indicate comparison
      */
-    bool MagicalContainer::SideCrossIterator::operator>(const MagicalContainer::SideCrossIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::SideCrossIterator::operator>(const SideCrossIterator &other) const
     {
-        return (this->index_ > other.index_);
+        return (this->position_ > other.position_);
+    }
+
+    /**
+     * @brief overload three way comparison, gives <= and >=
+     * @param other reference for another iterator
+     * @return ordering of the iterators positions
+     */
+    template <Duplicates Policy>
+    std::strong_ordering BasicMagicalContainer<Policy>::SideCrossIterator::operator<=>(const SideCrossIterator &other) const
+    {
+        return this->position_ <=> other.position_;
     }
 
 
@@ -331,13 +912,18 @@ namespace ariel
      * @param other reference for another itertator
      * @return
      */
-    MagicalContainer::SideCrossIterator& MagicalContainer::SideCrossIterator::operator=(const MagicalContainer::SideCrossIterator &other)
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator& BasicMagicalContainer<Policy>::SideCrossIterator::operator=(const SideCrossIterator &other)
     {
-        // check if containers are equal
-        if (container_.container_ != other.container_.container_) throw std::runtime_error("cant assign iterator on different container");
+        // a default constructed iterator takes the container of other
+        if (container_ == nullptr) container_ = other.container_;
 
-        // containers are equal so assign index
-        index_ = other.index_;
+        // check if both iterators belong to the same container, by address
+        if (container_ != other.container_) throw std::runtime_error("cant assign iterator on different container");
+
+        // same container so assign index
+        position_ = other.position_;
+        epoch_ = other.epoch_;
         return *this;
     }
 
@@ -347,59 +933,181 @@ namespace ariel
      * @brief set iterator index at zero
      * @return iterator of the beginning of the container
      */
-    MagicalContainer::SideCrossIterator MagicalContainer::SideCrossIterator::begin() const
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator BasicMagicalContainer<Policy>::SideCrossIterator::begin() const
     {
-        return MagicalContainer::SideCrossIterator(this->container_);
+        return SideCrossIterator(*this->container_);
     }
 
     /**
-     * @brief set iterator index at nid index of the container
+     * @brief set iterator position past the last element
      * @return iterator of the beginning of the container
      */
-    MagicalContainer::SideCrossIterator MagicalContainer::SideCrossIterator::end() const
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::SideCrossIterator BasicMagicalContainer<Policy>::SideCrossIterator::end() const
+    {
+        return SideCrossIterator(*this->container_, this->container_->asc_container_.size(), this->container_->epoch_);
+    }
+
+    /**
+     * @brief copy elements in cross order, a front and a back element per step, and advance the iterator past them
+     * @param out buffer to fill
+     * @return number of elements copied, less than out size only at the end of the container
+     */
+    template <Duplicates Policy>
+    std::size_t BasicMagicalContainer<Policy>::SideCrossIterator::emitPairs(std::span<int> out)
     {
-        return MagicalContainer::SideCrossIterator(this->container_, this->container_.getAscContainer().size());
+        container_->checkEpoch_(epoch_);
+        const int *elements = container_->asc_container_.data();
+        std::size_t size = container_->asc_container_.size();
+        std::size_t count = std::min(out.size(), size - position_);
+        std::size_t written = 0;
+
+        // odd start, finish the pair first
+        if (count > 0 && (position_ & 1U) != 0) out[written++] = elements[ascIndex(position_, size)];
+
+        std::size_t front = (position_ + written) >> 1U;
+        std::size_t back = size - 1 - front;
+        for (; written + 1 < count; written += 2)
+        {
+            out[written] = elements[front++];
+            out[written + 1] = elements[back--];
+        }
+        if (written < count) out[written++] = elements[front]; // lone front element
+        position_ += written;
+        return written;
     }
 
 
 //----------- PrimeIterator class ---------------------------------------
     // **** define constructors ****
     /**
-     * @brief constructor
+     * @brief default constructor, the iterator is attached to a container on its first assignment
+     */
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::PrimeIterator::PrimeIterator(): container_(nullptr), index_(0), epoch_(0), asc_index_(0), version_(STALE) {}
+
+    /**
+     * @brief constructor, the staged elements of the container are merged first and the asc index of the prime is
+     * looked up on first use
      * @param container reference for the Magical Container
      * @param index index of the iterator
      */
-    MagicalContainer::PrimeIterator::PrimeIterator(ariel::MagicalContainer &container, std::size_t index): container_(container), index_(index) {}
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::PrimeIterator::PrimeIterator(BasicMagicalContainer &container, std::size_t index): container_(&container), index_(index), epoch_(container.epoch_), asc_index_(0), version_(STALE)
+    {
+        container.mergeIfStaged_(); // a merge only adds elements, the epoch stays
+    }
+
+    /**
+     * @brief iterator at index that does not merge the staged elements, so end can be called on every step of a walk
+     * without changing the elements under it
+     * @param container reference for the Magical Container
+     * @param index index of the iterator
+     * @param epoch container epoch of the iterator
+     */
+    template <Duplicates Policy>
+    BasicMagicalContainer<Policy>::PrimeIterator::PrimeIterator(BasicMagicalContainer &container, std::size_t index, std::size_t epoch): container_(&container), index_(index), epoch_(epoch), asc_index_(0), version_(STALE) {}
 
     // **** define overload operators ***
     /**
-     * @brief overload dereference operator
-     * @return reference for the element at index
+     * @brief overload the post increment operator
+     * @return object of the iterator before increment
      */
-    int& MagicalContainer::PrimeIterator::operator*()
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator BasicMagicalContainer<Policy>::PrimeIterator::operator++(int)
     {
-        return *container_.prime_container_.at(index_);
+        PrimeIterator before = *this;
+        ++*this;
+        return before;
     }
 
     /**
-     * @brief overload the pre increment operator
-     * @return object of the iterator at incremented index
+     * @brief overload the post -- operator
+     * @return iterator before decrement
      */
-    MagicalContainer::PrimeIterator &MagicalContainer::PrimeIterator::operator++()
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator BasicMagicalContainer<Policy>::PrimeIterator::operator--(int)
     {
-        // throw exception if increment over boundaries
-        if(end().index_ == index_) throw std::runtime_error("cant increment beyond boundaries");
+        PrimeIterator before = *this;
+        --*this;
+        return before;
+    }
 
-        ++index_;
+    /**
+     * @brief overload subscript operator
+     * @param offset distance in primes from the iterator
+     * @return reference of the prime offset primes away
+     */
+    template <Duplicates Policy>
+    int& BasicMagicalContainer<Policy>::PrimeIterator::operator[](difference_type offset) const {return *(*this + offset);}
+
+    /**
+     * @brief overload the += operator, jumps in O(1), the asc index is selected again on the next dereference
+     * @param offset number of primes to move, may be negative
+     * @return iterator after the move
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator& BasicMagicalContainer<Policy>::PrimeIterator::operator+=(difference_type offset)
+    {
+        index_ = static_cast<std::size_t>(static_cast<difference_type>(index_) + offset);
+        if (offset != 0) version_ = STALE;
         return *this;
     }
 
+    /**
+     * @brief overload the -= operator, jumps in O(1)
+     * @param offset number of primes to move back, may be negative
+     * @return iterator after the move
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator& BasicMagicalContainer<Policy>::PrimeIterator::operator-=(difference_type offset)
+    {
+        return *this += -offset;
+    }
+
+    /**
+     * @brief overload the + operator
+     * @param offset number of primes from the iterator
+     * @return new iterator offset primes away
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator BasicMagicalContainer<Policy>::PrimeIterator::operator+(difference_type offset) const
+    {
+        PrimeIterator moved = *this;
+        return moved += offset;
+    }
+
+    /**
+     * @brief overload the - operator
+     * @param offset number of primes from the iterator
+     * @return new iterator offset primes back
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator BasicMagicalContainer<Policy>::PrimeIterator::operator-(difference_type offset) const
+    {
+        PrimeIterator moved = *this;
+        return moved -= offset;
+    }
+
+    /**
+     * @brief overload the distance operator
+     * @param other reference to another iterator
+     * @return number of primes from other to this iterator
+     */
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator::difference_type BasicMagicalContainer<Policy>::PrimeIterator::operator-(const PrimeIterator &other) const
+    {
+        return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+    }
+
     /**
      * @brief overload equality operator
      * @param other reference for other primeIterator
      * @return bool that indicated if iterator at the same index
      */
-    bool MagicalContainer::PrimeIterator::operator==(const MagicalContainer::PrimeIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::PrimeIterator::operator==(const PrimeIterator &other) const
     {
         return (this->index_ == other.index_);
     }
@@ -409,7 +1117,8 @@ namespace ariel
      * @param other reference for other primeIterator
      * @return bool that indicated if iterator not at the same index
      */
-    bool MagicalContainer::PrimeIterator::operator!=(const MagicalContainer::PrimeIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::PrimeIterator::operator!=(const PrimeIterator &other) const
     {
         return !(*this == other);
     }
@@ -419,7 +1128,8 @@ namespace ariel
      * @param other reference for another iterator
      * @return bool that indicate comparison
      */
-    bool MagicalContainer::PrimeIterator::operator<(const MagicalContainer::PrimeIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::PrimeIterator::operator<(const PrimeIterator &other) const
     {
         return (this->index_ < other.index_);
     }
@@ -429,23 +1139,42 @@ namespace ariel
      * @param other reference for another iterator
      * @return bool that indicate comparison
      */
-    bool MagicalContainer::PrimeIterator::operator>(const MagicalContainer::PrimeIterator &other) const
+    template <Duplicates Policy>
+    bool BasicMagicalContainer<Policy>::PrimeIterator::operator>(const PrimeIterator &other) const
     {
         return (this->index_ > other.index_);
     }
 
+    /**
+     * @brief overload three way comparison, gives <= and >=
+     * @param other reference for another iterator
+     * @return ordering of the iterators ranks
+     */
+    template <Duplicates Policy>
+    std::strong_ordering BasicMagicalContainer<Policy>::PrimeIterator::operator<=>(const PrimeIterator &other) const
+    {
+        return this->index_ <=> other.index_;
+    }
+
     /**
      * @brief assign iterator overload
      * @param other reference for another itertator
      * @return
      */
-    MagicalContainer::PrimeIterator& MagicalContainer::PrimeIterator::operator=(const MagicalContainer::PrimeIterator &other)
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator& BasicMagicalContainer<Policy>::PrimeIterator::operator=(const PrimeIterator &other)
     {
-        // check if containers are equal
-        if (container_.container_ != other.container_.container_) throw std::runtime_error("cant assign iterator on different container");
+        // a default constructed iterator takes the container of other
+        if (container_ == nullptr) container_ = other.container_;
 
-        // containers are equal so assign index
+        // check if both iterators belong to the same container, by address
+        if (container_ != other.container_) throw std::runtime_error("cant assign iterator on different container");
+
+        // same container so assign index and the cached position
         index_ = other.index_;
+        epoch_ = other.epoch_;
+        asc_index_ = other.asc_index_;
+        version_ = other.version_;
         return *this;
     }
 
@@ -453,18 +1182,61 @@ namespace ariel
      * create instance of iterator at 0 index
      * @return instance of iterator at index 0
      */
-    MagicalContainer::PrimeIterator MagicalContainer::PrimeIterator::begin() const
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator BasicMagicalContainer<Policy>::PrimeIterator::begin() const
     {
-        return MagicalContainer::PrimeIterator(this->container_);
+        return PrimeIterator(*this->container_);
     }
 
     /**
      * create instance of iterator at last index
      * @return instance of iterator at index last
      */
-    MagicalContainer::PrimeIterator MagicalContainer::PrimeIterator::end() const
+    template <Duplicates Policy>
+    typename BasicMagicalContainer<Policy>::PrimeIterator BasicMagicalContainer<Policy>::PrimeIterator::end() const
     {
-        return MagicalContainer::PrimeIterator(this->container_, this->container_.prime_container_.size());
+        return PrimeIterator(*this->container_, this->container_->prime_bits_.ones(), this->container_->epoch_);
     }
 
+    /**
+     * @brief gather the next prime elements by scanning the prime bits and advance the iterator past them
+     * @param out buffer to fill
+     * @return number of elements copied, less than out size only at the end of the primes
+     */
+    template <Duplicates Policy>
+    std::size_t BasicMagicalContainer<Policy>::PrimeIterator::nextBatch(std::span<int> out)
+    {
+        container_->checkEpoch_(epoch_);
+        const int *elements = container_->asc_container_.data();
+        const RankSelect &bits = container_->prime_bits_;
+        std::size_t count = std::min(out.size(), container_->prime_bits_.ones() - index_);
+        std::size_t position = ascIndex();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out[i] = elements[position];
+            position = bits.nextOne(position + 1);
+        }
+        index_ += count;
+        asc_index_ = position;
+        return count;
+    }
+
+
+    // every duplicate policy is compiled here
+    template class BasicMagicalContainer<Duplicates::Unique>;
+    template class BasicMagicalContainer<Duplicates::Multiset>;
+    template class BasicMagicalContainer<Duplicates::Counted>;
+
+    static_assert(std::random_access_iterator<MagicalContainer::AscendingIterator>);
+    static_assert(std::contiguous_iterator<MagicalContainer::AscendingIterator>);
+    static_assert(std::sized_sentinel_for<MagicalContainer::AscendingSentinel, MagicalContainer::AscendingIterator>);
+    static_assert(std::ranges::range<MagicalContainer>);
+    static_assert(std::random_access_iterator<MagicalContainer::SideCrossIterator>);
+    static_assert(std::ranges::random_access_range<MagicalContainer::SideCrossView>);
+    static_assert(std::random_access_iterator<MagicalContainer::PrimeIterator>);
+    static_assert(std::ranges::random_access_range<MagicalContainer::PrimeView>);
+    static_assert(std::ranges::view<MagicalContainer::AscendingView> && std::ranges::borrowed_range<MagicalContainer::AscendingView>);
+    static_assert(std::ranges::contiguous_range<MagicalContainer::AscendingView> && std::ranges::sized_range<MagicalContainer::AscendingView>);
+    static_assert(std::ranges::view<MagicalContainer::SideCrossView> && std::ranges::borrowed_range<MagicalContainer::SideCrossView>);
+    static_assert(std::ranges::view<MagicalContainer::PrimeView> && std::ranges::borrowed_range<MagicalContainer::PrimeView>);
 }
@@ -1,67 +1,229 @@
+#pragma once
 #include <vector>
-#include <set>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <span>
+#include <ranges>
+#include <iterator>
+#include <compare>
 #include <iostream>
 #include <stdexcept>
+#include "PrimeSieve.hpp"
+#include "RankSelect.hpp"
+#include "MagicalSnapshot.hpp"
+#include "Parallel.hpp"
+#include "StagingRing.hpp"
+
+// iterators bounds check, throw at the boundaries and detect removals unless built with NDEBUG.
+// define MAGICAL_CONTAINER_CHECKED to 0 or 1 to choose explicitly, every translation unit must agree
+#ifndef MAGICAL_CONTAINER_CHECKED
+#ifdef NDEBUG
+#define MAGICAL_CONTAINER_CHECKED 0
+#else
+#define MAGICAL_CONTAINER_CHECKED 1
+#endif
+#endif
 
 using namespace std;
 namespace ariel {
+    inline constexpr bool CHECKED_ITERATORS = MAGICAL_CONTAINER_CHECKED != 0; // iterators run with full validation
+    inline constexpr std::size_t MAX_TRACKED_CHANGES = 8 * MagicalSnapshot::CHUNK_SIZE; // changes recorded between two publishes, past it the next publish copies every chunk
+
+    // what removeElements does with elements that are not in the container
+    enum class MissingElements
+    {
+        Throw, // throw before removing anything
+        Skip, // ignore them
+        Report // ignore them and return them to the caller
+    };
+
+    // how a container stores elements that are added more than once, fixed at compile time
+    enum class Duplicates
+    {
+        Unique, // every element is stored once, adding it again is ignored
+        Multiset, // every copy is stored and visited by the iterators
+        Counted // every element is stored once with the number of times it was added
+    };
+
+//----------- OrderView class ---------------------------------------
+    // lightweight view over one order of a container. it only holds the container address, so it is O(1) to make and
+    // copy, and its iterators stay valid after the view is gone
+    template <class Container, class Iterator, class Sentinel>
+    class OrderView : public std::ranges::view_interface<OrderView<Container, Iterator, Sentinel>>
+    {
+    private:
+        // **** declare attributes ****
+        Container* container_ = nullptr;
+
+    public:
+        // **** declare & define constructors ****
+        OrderView() = default; // view that is not attached to a container
+        explicit OrderView(Container& container): container_(&container) {} // view over container
+
+        // **** declare & define functions ****
+        Iterator begin() const {return Iterator(*container_);} // return iterator at the first element of the order
+        Sentinel end() const {return {};} // return the end of the order
+        std::reverse_iterator<Iterator> rbegin() const {return std::reverse_iterator<Iterator>(begin().end());} // return reverse iterator at the last element of the order
+        std::reverse_iterator<Iterator> rend() const {return std::reverse_iterator<Iterator>(begin());} // return reverse iterator past the first element of the order
+        std::ranges::subrange<std::reverse_iterator<Iterator>> reversed() const {return {rbegin(), rend()};} // return the order walked backwards
+        std::ranges::subrange<Iterator> part(std::size_t part, std::size_t parts) const requires std::random_access_iterator<Iterator> // return part of parts disjoint subranges covering the order, in O(1)
+        {
+            auto size = static_cast<std::size_t>(end() - begin());
+            Iterator first = begin();
+            return {first + static_cast<std::ptrdiff_t>(size * part / parts), first + static_cast<std::ptrdiff_t>(size * (part + 1) / parts)};
+        }
+    };
+
 //----------- MagicalContainer class ---------------------------------------
-    class MagicalContainer
+    // the elements live in one sorted vector, so the ascending iterator is contiguous and every order is indexed in O(1).
+    // a single addElement or removeElement binary searches its position and shifts the tail once: O(log N) for appends
+    // and near sorted feeds, O(N) for random order. unsorted feeds go through the bulk paths instead: addElements and
+    // removeElements merge a batch in one pass, build sorts a whole array on many threads and stageElement queues near sorted
+    // elements for a batched merge that only touches the tail
+    template <Duplicates Policy = Duplicates::Unique>
+    class BasicMagicalContainer
     {
     private:
         // **** declare attributes ****
-        std::set<int> container_; // store all element
-        std::vector<int> asc_container_; // store all element in ascending order
-        std::vector<int *> prime_container_; // store all prime element in insert order
+        std::vector<int> asc_container_; // store all element in ascending order, the single copy of every element
+        RankSelect prime_bits_; // prime bit of every element in asc container, computed once at insert. rank and select map prime and asc indices
+        std::vector<std::uint32_t> counts_; // Counted only, number of times every element in asc container was added
+        std::size_t count_total_ = 0; // Counted only, sum of counts
+        std::size_t epoch_ = newToken_(); // token of the last removal, checked iterators compare it to detect stale positions
+        std::size_t version_ = newToken_(); // token of the last change to element positions, prime iterators revalidate their cached position with it
+        PrimeSieve sieve_; // classify elements as prime or not
+        SnapshotSlot published_; // latest snapshot published for readers on other threads
+        std::vector<int> changed_; // elements added or removed since the last publish, publish copies only the chunks they fall in
+        bool rebuilt_ = true; // set before the first publish and when too much changed since the last one, nothing is recorded and publish copies every chunk
+        StagingRing staging_; // elements staged by a producer thread, merged before the next change or traversal
 
-        static bool isPrime_(int element); // check if element is prime for prime container
-        void addSortedElement_(int element); // add element to sorted container
-        void addPrimeElement_(int element); // add element pointer if its prime
-        void removeSortedElement_(int element); // add element to sorted container
-        void removePrimeElement_(int element); // add element pointer if its prime
-        void updatePrimeAddress_(); // update primeContainer elements addresses
+        static std::size_t newToken_() {static std::atomic<std::size_t> next = 1; return next.fetch_add(1, std::memory_order_relaxed);} // return a state token no container has used, so a state copied by assignment never matches a token an iterator saved from another state
+        bool isPrime_(int element); // check if element is prime for prime container
+        std::size_t addSortedElement_(int element); // add element to sorted container, return its index
+        void addPrimeElement_(int element, std::size_t index); // insert the prime bit of element at index
+        std::size_t removeSortedElement_(int element); // remove element from sorted container, return its former index
+        void removePrimeElement_(std::size_t index); // remove the prime bit of the element at index
+        void addBatch_(std::vector<int> batch); // sort, dedup and merge a batch of elements into all containers
+        std::vector<int> removeBatch_(std::vector<int> batch, MissingElements policy); // sort, dedup and compact a batch of elements out of all containers
+        void markChanged_(std::span<const int> elements); // record elements added or removed for the next publish
+
+        // **** declare & define iterator access ****
+        int& ascAt_(std::size_t index) {if constexpr (CHECKED_ITERATORS) return asc_container_.at(index); else return asc_container_[index];} // element at asc index, bounds checked in checked builds
+        std::size_t primeAt_(std::size_t index) const {return index < prime_bits_.ones() ? prime_bits_.select(index) : asc_container_.size();} // asc index of the prime at index, asc size past the last prime
+        void mergeIfStaged_() {if (!staging_.empty()) mergeStaged();} // merge the staged elements, if any, before a traversal or a change
+        void checkEpoch_(std::size_t epoch) const {if (CHECKED_ITERATORS && epoch != epoch_) throw std::runtime_error("iterator used after an element was removed");} // throw in checked builds if an element was removed since epoch
+        static void checkIncrement_(std::size_t position, std::size_t end) {if (CHECKED_ITERATORS && position == end) throw std::runtime_error("cant increment beyond boundaries");} // throw in checked builds if position is already at end
+        static void checkDecrement_(std::size_t position) {if (CHECKED_ITERATORS && position == 0) throw std::runtime_error("cant decrement beyond boundaries");} // throw in checked builds if position is already at the beginning
 
     public:
         // **** declare & define constructors ****
-        MagicalContainer(); // default constructor
-        MagicalContainer(MagicalContainer &other); // copy constructor
-        ~MagicalContainer(){}; // destructor
+        BasicMagicalContainer(); // default constructor
+        BasicMagicalContainer(const BasicMagicalContainer &other); // copy constructor, the staged elements of other are staged in the copy
+        ~BasicMagicalContainer(){}; // destructor
 
         // **** declare & define getters ****
-        std::set<int> getContainer() const {return this->container_;} // return the elements container
-        std::vector<int> getAscContainer() const {return this->asc_container_;} // return the elements asc container
-        std::vector<int *> getPrimeContainer() const {return this->prime_container_;} // return the elements prime container
-        std::size_t size() const {return container_.size();} // return the size of the container
+        const std::vector<int>& getAscContainer() const {return this->asc_container_;} // return the elements asc container
+        const RankSelect& primeBits() const {return this->prime_bits_;} // return the prime bit of every element in the asc container
+        std::span<const int> ascView() const {return this->asc_container_;} // return a view of the elements in ascending order
+        std::size_t ascSize() const {return asc_container_.size();} // return the number of elements in the asc container
+        std::size_t primeCount() const {return prime_bits_.ones();} // return the number of prime elements
+        std::size_t primeIndex(std::size_t rank) const {return prime_bits_.select(rank);} // return the asc index of the prime element of rank, rank below primeCount
+        std::size_t primeRank(std::size_t index) const {return prime_bits_.rank(index);} // return the number of prime elements before asc index
+        std::size_t primesBefore(int element) const {return primeRank(static_cast<std::size_t>(std::lower_bound(asc_container_.begin(), asc_container_.end(), element) - asc_container_.begin()));} // return the number of prime elements smaller than element
+        std::size_t size() const {return asc_container_.size();} // return the number of elements the iterators visit, Counted visits every element once
+        std::size_t totalCount() const {if constexpr (Policy == Duplicates::Counted) return count_total_; else return asc_container_.size();} // return the number of copies added and not removed, the sum of count over the elements
+        std::size_t count(int element) const; // return how many times element is in the container
+        bool contains(int element) const {return std::binary_search(asc_container_.begin(), asc_container_.end(), element);} // check if element is in the container
 
         // **** declare functions ****
-        void removeElement(int element); // remove element to all containers
-        void addElement(int element); // add element to all containers
+        void removeElement(int element); // remove element to all containers, shifts the tail once
+        void addElement(int element); // add element to all containers, shifts the tail once. use addElements, build or stageElement for unsorted feeds
+        void addElements(std::ranges::input_range auto &&elements) // add every element of a range to all containers in one merge pass
+        {
+            mergeIfStaged_();
+            std::vector<int> batch;
+            if constexpr (std::ranges::sized_range<decltype(elements)>) batch.reserve(std::ranges::size(elements));
+            for (auto &&element : elements) batch.push_back(static_cast<int>(element));
+            addBatch_(std::move(batch));
+        }
+        std::vector<int> removeElements(std::ranges::input_range auto &&elements, MissingElements policy = MissingElements::Throw) // remove every element of a range in one compaction pass
+        {
+            mergeIfStaged_();
+            std::vector<int> batch;
+            if constexpr (std::ranges::sized_range<decltype(elements)>) batch.reserve(std::ranges::size(elements));
+            for (auto &&element : elements) batch.push_back(static_cast<int>(element));
+            return removeBatch_(std::move(batch), policy);
+        }
+        void build(std::span<const int> elements, ExecutionPolicy policy = {}); // replace the elements with an unsorted array, sorted, deduped and classified by policy.threads threads
+        std::shared_ptr<const MagicalSnapshot> publish(); // publish a snapshot of the current elements to snapshot readers, call from the writing thread
+        std::shared_ptr<const MagicalSnapshot> snapshot(); // return a snapshot of the current elements, published first if anything changed since the last publish. call from the writing thread
+        std::shared_ptr<const MagicalSnapshot> latestPublished() const; // return the latest published snapshot, safe from any thread while one thread writes
+        void reserveStaging(std::size_t capacity); // make room for capacity staged elements, call before the producer thread starts
+        bool stageElement(int element) {return staging_.push(element);} // stage element in O(1) without touching the sorted store, false when the staging ring is full. safe from one producer thread
+        std::size_t mergeStaged(); // merge every staged element in one batch, return how many. queries, iterators, traversals and changes do it on their own, on the thread that owns the container
+        std::size_t stagedCount() const {return staging_.size();} // return the number of staged elements not merged yet, safe from any thread. const queries never merge, so they do not see these until a non const call merges them
+
+        // **** declare sentinels ****
+        struct AscendingSentinel {}; // end of the ascending order, compared against the live container size
+        struct SideCrossSentinel {}; // end of the cross order, compared against the live container size
+        struct PrimeSentinel {}; // end of the prime order, compared against the live prime count
 
 //----------- AscendingIterator class ---------------------------------------
         class AscendingIterator
         {
         private:
             // **** declare attributes ****
-            MagicalContainer& container_;
+            BasicMagicalContainer* container_;
             std::size_t index_;
+            std::size_t epoch_; // container epoch when the iterator was made
+
+            AscendingIterator(BasicMagicalContainer& container, std::size_t index, std::size_t epoch); // iterator at index that leaves the staged elements alone, for end
 
         public:
+            // **** declare iterator traits ****
+            using iterator_concept = std::contiguous_iterator_tag;
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = int;
+            using difference_type = std::ptrdiff_t;
+            using pointer = int*;
+            using reference = int&;
+
             // **** declare & define constructors ****
-            AscendingIterator(MagicalContainer& container, std::size_t index=0); // initialize iterator
+            AscendingIterator(); // iterator that is not attached to a container yet
+            AscendingIterator(BasicMagicalContainer& container, std::size_t index=0); // initialize iterator, the staged elements are merged first
 
             // **** overload operators ****
-            int& operator*(); // overload the dereference operator
-            MagicalContainer::AscendingIterator& operator++ (); // overload the ++ operator
-            bool operator !=(const MagicalContainer::AscendingIterator& other) const; // overload inequality operator
-            bool operator ==(const MagicalContainer::AscendingIterator& other) const; // overload equality operator
-            bool operator <(const MagicalContainer::AscendingIterator& other) const; // overload comparison operator
-            bool operator >(const MagicalContainer::AscendingIterator& other) const; // overload comparison operator
-            MagicalContainer::AscendingIterator& operator =(const MagicalContainer::AscendingIterator& other); // overload assigment operator
+            int& operator*() const {container_->checkEpoch_(epoch_); return container_->ascAt_(index_);} // overload the dereference operator
+            int* operator->() const; // overload the member access operator
+            int& operator[](difference_type offset) const; // overload the subscript operator
+            AscendingIterator& operator++ () {checkIncrement_(index_, container_->asc_container_.size()); ++index_; return *this;} // overload the ++ operator
+            AscendingIterator operator++ (int); // overload the post ++ operator
+            AscendingIterator& operator-- () {checkDecrement_(index_); --index_; return *this;} // overload the -- operator
+            AscendingIterator operator-- (int); // overload the post -- operator
+            AscendingIterator& operator +=(difference_type offset); // overload the += operator
+            AscendingIterator& operator -=(difference_type offset); // overload the -= operator
+            AscendingIterator operator +(difference_type offset) const; // overload the + operator
+            AscendingIterator operator -(difference_type offset) const; // overload the - operator
+            difference_type operator -(const AscendingIterator& other) const; // overload the distance operator
+            friend AscendingIterator operator +(difference_type offset, const AscendingIterator& iterator) {return iterator + offset;} // overload the offset + iterator operator
+            difference_type operator -(AscendingSentinel) const {return static_cast<difference_type>(index_) - static_cast<difference_type>(container_->asc_container_.size());} // overload the distance to end operator
+            friend difference_type operator -(AscendingSentinel sentinel, const AscendingIterator& iterator) {return -(iterator - sentinel);} // overload the distance from end operator
+            bool operator ==(AscendingSentinel) const {return index_ == container_->asc_container_.size();} // overload equality with the end of the container
+            bool operator !=(const AscendingIterator& other) const; // overload inequality operator
+            bool operator ==(const AscendingIterator& other) const; // overload equality operator
+            bool operator <(const AscendingIterator& other) const; // overload comparison operator
+            bool operator >(const AscendingIterator& other) const; // overload comparison operator
+            std::strong_ordering operator <=>(const AscendingIterator& other) const; // overload three way comparison operator
+            AscendingIterator& operator =(const AscendingIterator& other); // overload assigment operator
 
 
             // **** declare functions ****
-            MagicalContainer::AscendingIterator begin() const; // return asc_iterator that point to the beginning of the container
-            MagicalContainer::AscendingIterator end() const; // return asc_iterator that point to the end of the container
+            AscendingIterator begin() const; // return asc_iterator that point to the beginning of the container
+            AscendingIterator end() const; // return asc_iterator that point to the end of the container
+            std::reverse_iterator<AscendingIterator> rbegin() const {return std::reverse_iterator<AscendingIterator>(end());} // return reverse iterator at the largest element
+            std::reverse_iterator<AscendingIterator> rend() const {return std::reverse_iterator<AscendingIterator>(begin());} // return reverse iterator past the smallest element
+            std::size_t nextBatch(std::span<int> out); // copy the next elements to out, return how many were copied
 
         };
 
@@ -70,26 +232,62 @@ namespace ariel {
         {
         private:
             // **** declare attributes ****
-            MagicalContainer& container_;
-            std::size_t index_;
+            BasicMagicalContainer* container_;
+            std::size_t position_; // position in cross order, the front and back cursors are derived from it
+            std::size_t epoch_; // container epoch when the iterator was made
+
+            SideCrossIterator(BasicMagicalContainer& container, std::size_t position, std::size_t epoch); // iterator at position that leaves the staged elements alone, for end
 
         public:
+            // **** declare iterator traits ****
+            using iterator_concept = std::random_access_iterator_tag;
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = int;
+            using difference_type = std::ptrdiff_t;
+            using pointer = int*;
+            using reference = int&;
+
             // **** declare constructors ****
-            SideCrossIterator(MagicalContainer& container, std::size_t index=0); // constructor
+            SideCrossIterator(); // iterator that is not attached to a container yet
+            SideCrossIterator(BasicMagicalContainer& container, std::size_t position=0); // constructor, the staged elements are merged first
+
+            // **** declare & define static functions ****
+            static std::size_t ascIndex(std::size_t position, std::size_t size) {return (position & 1U) != 0 ? size - 1 - (position >> 1U) : position >> 1U;} // asc container index of a cross order position
+            static std::size_t crossPosition(std::size_t index, std::size_t size) {return index < (size + 1) / 2 ? index << 1U : ((size - 1 - index) << 1U) + 1;} // cross order position of an asc container index
 
             // **** overload operators ****
-            int& operator*(); // overload the dereference operator
-            MagicalContainer::SideCrossIterator& operator++ (); // overload the ++ operator
-            bool operator !=(const MagicalContainer::SideCrossIterator& other) const; // overload inequality operator
-            bool operator ==(const MagicalContainer::SideCrossIterator& other) const; // overload equality operator
-            bool operator <(const MagicalContainer::SideCrossIterator& other) const; // overload comparison operator
-            bool operator >(const MagicalContainer::SideCrossIterator& other) const; // overload comparison operator
-            MagicalContainer::SideCrossIterator& operator =(const MagicalContainer::SideCrossIterator& other); // overload assigment operator
+            int& operator*() const {container_->checkEpoch_(epoch_); return container_->ascAt_(ascIndex(position_, container_->asc_container_.size()));} // overload the dereference operator
+            SideCrossIterator& operator++ () {checkIncrement_(position_, container_->asc_container_.size()); ++position_; return *this;} // overload the ++ operator
+            SideCrossIterator operator++ (int); // overload the post ++ operator
+            SideCrossIterator& operator-- () {checkDecrement_(position_); --position_; return *this;} // overload the -- operator
+            SideCrossIterator operator-- (int); // overload the post -- operator
+            int& operator[](difference_type offset) const; // overload the subscript operator
+            SideCrossIterator& operator +=(difference_type offset); // overload the += operator
+            SideCrossIterator& operator -=(difference_type offset); // overload the -= operator
+            SideCrossIterator operator +(difference_type offset) const; // overload the + operator
+            SideCrossIterator operator -(difference_type offset) const; // overload the - operator
+            difference_type operator -(const SideCrossIterator& other) const; // overload the distance operator
+            friend SideCrossIterator operator +(difference_type offset, const SideCrossIterator& iterator) {return iterator + offset;} // overload the offset + iterator operator
+            bool operator ==(SideCrossSentinel) const {return position_ == container_->asc_container_.size();} // overload equality with the end of the container
+            difference_type operator -(SideCrossSentinel) const {return static_cast<difference_type>(position_) - static_cast<difference_type>(container_->asc_container_.size());} // overload the distance to end operator
+            friend difference_type operator -(SideCrossSentinel sentinel, const SideCrossIterator& iterator) {return -(iterator - sentinel);} // overload the distance from end operator
+            bool operator !=(const SideCrossIterator& other) const; // overload inequality operator
+            bool operator ==(const SideCrossIterator& other) const; // overload equality operator
+            bool operator <(const SideCrossIterator& other) const; // overload comparison operator
+            bool operator >(const SideCrossIterator& other) const; // overload comparison operator
+            std::strong_ordering operator <=>(const SideCrossIterator& other) const; // overload three way comparison operator
+            SideCrossIterator& operator =(const SideCrossIterator& other); // overload assigment operator
 
 
             // **** declare functions ****
-            MagicalContainer::SideCrossIterator begin() const; // return asc_iterator that point to the beginning of the container
-            MagicalContainer::SideCrossIterator end() const; // return asc_iterator that point to the end of the container
+            SideCrossIterator begin() const; // return asc_iterator that point to the beginning of the container
+            SideCrossIterator end() const; // return asc_iterator that point to the end of the container
+            std::reverse_iterator<SideCrossIterator> rbegin() const {return std::reverse_iterator<SideCrossIterator>(end());} // return reverse iterator at the last element in cross order
+            std::reverse_iterator<SideCrossIterator> rend() const {return std::reverse_iterator<SideCrossIterator>(begin());} // return reverse iterator past the first element in cross order
+            std::size_t emitPairs(std::span<int> out); // copy the next elements in cross order to out, return how many were copied
+            std::size_t nextBatch(std::span<int> out) {return emitPairs(out);} // copy the next elements to out, return how many were copied
+            std::size_t position() const {return position_;} // return the position in cross order
+            std::size_t ascIndex() const {return ascIndex(position_, container_->asc_container_.size());} // return the asc container index of the current element
 
 
         };
@@ -98,26 +296,100 @@ namespace ariel {
         {
         private:
             // **** declare attributes ****
-            MagicalContainer& container_;
-            std::size_t index_;
+            BasicMagicalContainer* container_;
+            std::size_t index_; // rank of the prime among the prime elements
+            std::size_t epoch_; // container epoch when the iterator was made
+            mutable std::size_t asc_index_; // cached asc index of the prime, valid while version_ matches the container
+            mutable std::size_t version_; // container version of asc_index_, STALE when it must be recomputed
+
+            static constexpr std::size_t STALE = SIZE_MAX; // version of a cache that was never computed
+
+            PrimeIterator(BasicMagicalContainer& container, std::size_t index, std::size_t epoch); // iterator at index that leaves the staged elements alone, for end
 
         public:
+            // **** declare iterator traits ****
+            using iterator_concept = std::random_access_iterator_tag;
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = int;
+            using difference_type = std::ptrdiff_t;
+            using pointer = int*;
+            using reference = int&;
+
             // **** declare constructors ****
-            PrimeIterator(MagicalContainer& container, std::size_t index=0); // parameterized constructor
+            PrimeIterator(); // iterator that is not attached to a container yet
+            PrimeIterator(BasicMagicalContainer& container, std::size_t index=0); // parameterized constructor, the staged elements are merged first
 
             // **** overload operators ****
-            int& operator*(); // overload the dereference operator
-            MagicalContainer::PrimeIterator& operator++ (); // overload the ++ operator
-            bool operator !=(const MagicalContainer::PrimeIterator& other) const; // overload inequality operator
-            bool operator ==(const MagicalContainer::PrimeIterator& other) const; // overload equality operator
-            bool operator <(const MagicalContainer::PrimeIterator& other) const; // overload comparison operator
-            bool operator >(const MagicalContainer::PrimeIterator& other) const; // overload comparison operator
-            MagicalContainer::PrimeIterator& operator =(const MagicalContainer::PrimeIterator& other); // overload assigment operator
+            int& operator*() const {container_->checkEpoch_(epoch_); return container_->ascAt_(ascIndex());} // overload the dereference operator
+            PrimeIterator& operator++ () // overload the ++ operator, steps to the next prime bit while the cache is valid
+            {
+                checkIncrement_(index_, container_->prime_bits_.ones());
+                if (version_ == container_->version_) asc_index_ = container_->prime_bits_.nextOne(asc_index_ + 1);
+                ++index_;
+                return *this;
+            }
+            PrimeIterator operator++ (int); // overload the post ++ operator
+            PrimeIterator& operator-- () // overload the -- operator, steps to the previous prime bit while the cache is valid
+            {
+                checkDecrement_(index_);
+                if (version_ == container_->version_) asc_index_ = container_->prime_bits_.prevOne(asc_index_ - 1);
+                --index_;
+                return *this;
+            }
+            PrimeIterator operator-- (int); // overload the post -- operator
+            int& operator[](difference_type offset) const; // overload the subscript operator
+            PrimeIterator& operator +=(difference_type offset); // overload the += operator
+            PrimeIterator& operator -=(difference_type offset); // overload the -= operator
+            PrimeIterator operator +(difference_type offset) const; // overload the + operator
+            PrimeIterator operator -(difference_type offset) const; // overload the - operator
+            difference_type operator -(const PrimeIterator& other) const; // overload the distance operator
+            friend PrimeIterator operator +(difference_type offset, const PrimeIterator& iterator) {return iterator + offset;} // overload the offset + iterator operator
+            bool operator ==(PrimeSentinel) const {return index_ == container_->prime_bits_.ones();} // overload equality with the end of the container
+            difference_type operator -(PrimeSentinel) const {return static_cast<difference_type>(index_) - static_cast<difference_type>(container_->prime_bits_.ones());} // overload the distance to end operator
+            friend difference_type operator -(PrimeSentinel sentinel, const PrimeIterator& iterator) {return -(iterator - sentinel);} // overload the distance from end operator
+            bool operator !=(const PrimeIterator& other) const; // overload inequality operator
+            bool operator ==(const PrimeIterator& other) const; // overload equality operator
+            bool operator <(const PrimeIterator& other) const; // overload comparison operator
+            bool operator >(const PrimeIterator& other) const; // overload comparison operator
+            std::strong_ordering operator <=>(const PrimeIterator& other) const; // overload three way comparison operator
+            PrimeIterator& operator =(const PrimeIterator& other); // overload assigment operator
 
             // **** declare functions ****
-            MagicalContainer::PrimeIterator begin() const; // return asc_iterator that point to the beginning of the container
-            MagicalContainer::PrimeIterator end() const; // return asc_iterator that point to the end of the container
+            PrimeIterator begin() const; // return asc_iterator that point to the beginning of the container
+            PrimeIterator end() const; // return asc_iterator that point to the end of the container
+            std::reverse_iterator<PrimeIterator> rbegin() const {return std::reverse_iterator<PrimeIterator>(end());} // return reverse iterator at the largest prime
+            std::reverse_iterator<PrimeIterator> rend() const {return std::reverse_iterator<PrimeIterator>(begin());} // return reverse iterator past the smallest prime
+            std::size_t nextBatch(std::span<int> out); // copy the next prime elements to out, return how many were copied
+            std::size_t rank() const {return index_;} // return the rank of the prime among the prime elements
+            std::size_t ascIndex() const // return the asc index of the prime, asc size at the end
+            {
+                if (version_ != container_->version_)
+                {
+                    asc_index_ = container_->primeAt_(index_);
+                    version_ = container_->version_;
+                }
+                return asc_index_;
+            }
         };
 
+        // **** declare views ****
+        using AscendingView = OrderView<BasicMagicalContainer, AscendingIterator, AscendingSentinel>; // elements in ascending order
+        using SideCrossView = OrderView<BasicMagicalContainer, SideCrossIterator, SideCrossSentinel>; // elements in side cross order
+        using PrimeView = OrderView<BasicMagicalContainer, PrimeIterator, PrimeSentinel>; // prime elements in ascending order
+
+        // **** declare & define range functions ****
+        AscendingIterator begin() {mergeIfStaged_(); return AscendingIterator(*this);} // return asc_iterator at the first element, the container iterates in ascending order
+        AscendingSentinel end() const {return {};} // return the end of the ascending order
+        std::reverse_iterator<AscendingIterator> rbegin() {return ascending().rbegin();} // return reverse iterator at the largest element
+        std::reverse_iterator<AscendingIterator> rend() {return ascending().rend();} // return reverse iterator past the smallest element
+        AscendingView ascending() {mergeIfStaged_(); return AscendingView(*this);} // return a view of the elements in ascending order
+        SideCrossView sideCross() {mergeIfStaged_(); return SideCrossView(*this);} // return a view of the elements in side cross order
+        PrimeView primes() {mergeIfStaged_(); return PrimeView(*this);} // return a view of the prime elements in ascending order
     };
-}
\ No newline at end of file
+
+    using MagicalContainer = BasicMagicalContainer<>; // container of unique elements
+}
+
+// order views only refer to the container, so iterators taken from a temporary view stay valid
+template <class Container, class Iterator, class Sentinel>
+inline constexpr bool std::ranges::enable_borrowed_range<ariel::OrderView<Container, Iterator, Sentinel>> = true;
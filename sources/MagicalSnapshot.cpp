@@ -0,0 +1,128 @@
+#include "MagicalSnapshot.hpp"
+#include <algorithm>
+#include <ranges>
+namespace ariel
+{
+//----------- MagicalSnapshot class ---------------------------------------
+    // **** define constructors ****
+    /**
+     * @brief empty snapshot
+     */
+    MagicalSnapshot::MagicalSnapshot(): offsets_(1, 0) {}
+
+    /**
+     * @brief snapshot of the elements of a container. a chunk of previous that no changed element falls in still
+     * appears as one run of elements and is shared without comparing its elements, so a publish costs a binary
+     * search per chunk plus the copied runs. the runs between shared chunks are copied into new chunks of at most
+     * CHUNK_SIZE elements. a prime bit depends only on the element, so shared runs keep their prime bits
+     * @param elements elements of the container in ascending order
+     * @param prime_bits prime bit of every element
+     * @param previous snapshot whose chunks may be shared, or null
+     * @param changed every element added or removed since previous, sorted. duplicates are allowed
+     */
+    MagicalSnapshot::MagicalSnapshot(std::span<const int> elements, const RankSelect &prime_bits, const MagicalSnapshot *previous, std::span<const int> changed)
+    {
+        // copy elements[first, last) into new chunks of equal length. a short run takes the chunks before it along, so
+        // scattered changes do not leave many tiny chunks
+        auto copyRun = [&](std::size_t first, std::size_t last) {
+            while (last - first < MIN_CHUNK_SIZE && !chunks_.empty())
+            {
+                first -= chunks_.back()->elements.size();
+                chunks_.pop_back();
+            }
+            std::size_t parts = (last - first + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            for (std::size_t part = 0; part < parts; ++part)
+            {
+                std::size_t begin = first + (last - first) * part / parts;
+                std::size_t end = first + (last - first) * (part + 1) / parts;
+                chunks_.push_back(makeChunk_(elements.subspan(begin, end - begin), prime_bits, begin));
+            }
+        };
+
+        // copies of the first element of a chunk that sit in the chunks before it, only duplicates straddle chunks
+        auto copiesBefore = [&](std::size_t chunk) {
+            int front = previous->chunks_[chunk]->elements.front();
+            std::size_t copies = 0;
+            while (chunk > 0 && previous->chunks_[chunk - 1]->elements.back() == front)
+            {
+                const std::vector<int> &run = previous->chunks_[--chunk]->elements;
+                copies += static_cast<std::size_t>(run.end() - std::lower_bound(run.begin(), run.end(), front));
+            }
+            return copies;
+        };
+
+        std::size_t position = 0;
+        if (previous != nullptr)
+        {
+            for (std::size_t index = 0; index < previous->chunks_.size(); ++index)
+            {
+                const auto &chunk = previous->chunks_[index];
+                const std::vector<int> &run = chunk->elements;
+                auto touched = std::lower_bound(changed.begin(), changed.end(), run.front());
+                if (touched != changed.end() && *touched <= run.back()) continue;
+
+                // nothing in [front, back] changed, so the run is intact and so is every copy of front before it
+                auto start = static_cast<std::size_t>(std::lower_bound(elements.begin(), elements.end(), run.front()) - elements.begin()) + copiesBefore(index);
+                if (start < position || start + run.size() > elements.size()) continue;
+                if (start > position) copyRun(position, start);
+                chunks_.push_back(chunk);
+                position = start + run.size();
+            }
+        }
+        if (position < elements.size()) copyRun(position, elements.size());
+
+        offsets_.reserve(chunks_.size() + 1);
+        offsets_.push_back(0);
+        for (const auto &chunk : chunks_)
+        {
+            offsets_.push_back(offsets_.back() + chunk->elements.size());
+            primes_ += chunk->primes;
+        }
+    }
+
+    // **** define function ****
+    /**
+     * @brief copy a run of elements and their prime bits into a new chunk
+     * @param elements the run
+     * @param prime_bits prime bit of every element of the container
+     * @param first asc index of the first element of the run
+     * @return the chunk
+     */
+    std::shared_ptr<const MagicalSnapshot::Chunk> MagicalSnapshot::makeChunk_(std::span<const int> elements, const RankSelect &prime_bits, std::size_t first)
+    {
+        auto chunk = std::make_shared<Chunk>();
+        chunk->elements.assign(elements.begin(), elements.end());
+        chunk->prime_words.assign((elements.size() + 63) / 64, 0);
+        for (std::size_t index = prime_bits.nextOne(first); index < first + elements.size(); index = prime_bits.nextOne(index + 1))
+        {
+            chunk->prime_words[(index - first) >> 6U] |= std::uint64_t{1} << ((index - first) & 63U);
+            ++chunk->primes;
+        }
+        return chunk;
+    }
+
+    /**
+     * @brief element at an asc index, the chunk is found by binary search over the chunk offsets
+     * @param index asc index, below size
+     * @return the element
+     */
+    int MagicalSnapshot::operator[](std::size_t index) const
+    {
+        auto chunk = static_cast<std::size_t>(std::upper_bound(offsets_.begin(), offsets_.end(), index) - offsets_.begin()) - 1;
+        return chunks_[chunk]->elements[index - offsets_[chunk]];
+    }
+
+    /**
+     * @brief check if element is in the snapshot, the chunk is found by binary search over the last chunk elements
+     * @param element element to look for
+     * @return true if the element is in the snapshot
+     */
+    bool MagicalSnapshot::contains(int element) const
+    {
+        auto chunk = std::lower_bound(chunks_.begin(), chunks_.end(), element, [](const std::shared_ptr<const Chunk> &run, int value) {return run->elements.back() < value;});
+        return chunk != chunks_.end() && std::binary_search((*chunk)->elements.begin(), (*chunk)->elements.end(), element);
+    }
+
+    static_assert(std::forward_iterator<MagicalSnapshot::AscendingIterator>);
+    static_assert(std::ranges::forward_range<MagicalSnapshot>);
+}
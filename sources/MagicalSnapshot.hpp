@@ -0,0 +1,155 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <vector>
+#include "RankSelect.hpp"
+
+namespace ariel {
+//----------- MagicalSnapshot class ---------------------------------------
+    // immutable copy of the elements of a container at one point in time. the elements are held in reference counted
+    // chunks, a newer snapshot shares every chunk whose elements did not change, and a chunk is freed when the last
+    // snapshot that holds it is gone. nothing in a snapshot changes after it is built, so any number of threads may
+    // read it without locks
+    class MagicalSnapshot
+    {
+    public:
+        static constexpr std::size_t CHUNK_SIZE = 4096; // most elements in a chunk
+        static constexpr std::size_t MIN_CHUNK_SIZE = CHUNK_SIZE / 4; // rebuilt runs shorter than this are joined to the chunk before them
+
+        // run of consecutive elements in ascending order with their prime bits
+        struct Chunk
+        {
+            std::vector<int> elements; // elements in ascending order
+            std::vector<std::uint64_t> prime_words; // bit i is set when elements[i] is prime
+            std::size_t primes = 0; // number of prime elements
+        };
+
+    private:
+        // **** declare attributes ****
+        std::vector<std::shared_ptr<const Chunk>> chunks_; // the elements in ascending order, split in chunks
+        std::vector<std::size_t> offsets_; // elements before every chunk, the extra last entry holds the size
+        std::size_t primes_ = 0; // number of prime elements
+
+        static std::shared_ptr<const Chunk> makeChunk_(std::span<const int> elements, const RankSelect &prime_bits, std::size_t first); // copy elements and their prime bits, starting at asc index first
+
+    public:
+        // **** declare constructors ****
+        MagicalSnapshot(); // empty snapshot
+        MagicalSnapshot(std::span<const int> elements, const RankSelect &prime_bits, const MagicalSnapshot *previous, std::span<const int> changed); // snapshot of elements, sharing the chunks of previous that no changed element falls in
+
+        // **** declare & define getters ****
+        std::size_t size() const {return offsets_.back();} // return the number of elements
+        std::size_t primeCount() const {return primes_;} // return the number of prime elements
+        const std::vector<std::shared_ptr<const Chunk>>& chunks() const {return chunks_;} // return the chunks in ascending order
+
+        // **** declare functions ****
+        int operator[](std::size_t index) const; // return the element at asc index, index below size
+        bool contains(int element) const; // check if element is in the snapshot
+
+//----------- AscendingIterator class ---------------------------------------
+        // walks the elements in ascending order chunk by chunk. the snapshot never changes, so the iterator never
+        // goes stale while the snapshot lives
+        class AscendingIterator
+        {
+        private:
+            // **** declare attributes ****
+            const MagicalSnapshot* snapshot_ = nullptr;
+            std::size_t chunk_ = 0; // chunk of the current element, the chunk count at the end
+            std::size_t index_ = 0; // index of the current element in its chunk, 0 at the end
+
+        public:
+            // **** declare iterator traits ****
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = int;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const int*;
+            using reference = const int&;
+
+            // **** declare & define constructors ****
+            AscendingIterator() = default; // iterator that is not attached to a snapshot yet
+            AscendingIterator(const MagicalSnapshot &snapshot, std::size_t chunk): snapshot_(&snapshot), chunk_(chunk) {} // iterator at the first element of chunk
+
+            // **** overload operators ****
+            const int& operator*() const {return snapshot_->chunks_[chunk_]->elements[index_];} // overload the dereference operator
+            AscendingIterator& operator++ () {if (++index_ == snapshot_->chunks_[chunk_]->elements.size()) {++chunk_; index_ = 0;} return *this;} // overload the ++ operator, chunks are never empty
+            AscendingIterator operator++ (int) {AscendingIterator copy = *this; ++*this; return copy;} // overload the post ++ operator
+            bool operator ==(const AscendingIterator& other) const {return chunk_ == other.chunk_ && index_ == other.index_;} // overload equality operator
+        };
+
+        // **** declare & define iterator access ****
+        AscendingIterator begin() const {return AscendingIterator(*this, 0);} // return an iterator at the smallest element
+        AscendingIterator end() const {return AscendingIterator(*this, chunks_.size());} // return an iterator past the largest element
+
+        // **** declare & define traversals ****
+        template <class Visitor>
+        void forEachAscending(Visitor visit) const // visit every element in ascending order
+        {
+            for (const auto &chunk : chunks_)
+            {
+                for (int element : chunk->elements) visit(element);
+            }
+        }
+
+        template <class Visitor>
+        void forEachPrime(Visitor visit) const // visit every prime element in ascending order
+        {
+            for (const auto &chunk : chunks_)
+            {
+                for (std::size_t word = 0; word < chunk->prime_words.size(); ++word)
+                {
+                    for (std::uint64_t bits = chunk->prime_words[word]; bits != 0; bits &= bits - 1)
+                    {
+                        visit(chunk->elements[(word << 6U) + static_cast<std::size_t>(std::countr_zero(bits))]);
+                    }
+                }
+            }
+        }
+
+        template <class Visitor>
+        void forEachSideCross(Visitor visit) const // visit every element in side cross order
+        {
+            // a front cursor walks the chunks up and a back cursor walks them down
+            std::size_t front_chunk = 0;
+            std::size_t front = 0;
+            std::size_t back_chunk = chunks_.size();
+            std::size_t back = 0;
+            for (std::size_t position = 0; position < size(); ++position)
+            {
+                if ((position & 1U) == 0)
+                {
+                    while (front == chunks_[front_chunk]->elements.size()) {++front_chunk; front = 0;}
+                    visit(chunks_[front_chunk]->elements[front++]);
+                }
+                else
+                {
+                    while (back == 0) back = chunks_[--back_chunk]->elements.size();
+                    visit(chunks_[back_chunk]->elements[--back]);
+                }
+            }
+        }
+    };
+
+//----------- SnapshotSlot class ---------------------------------------
+    // the latest published snapshot of a container. one writer stores and any number of readers load at the same
+    // time. copying a slot shares the snapshot it holds
+    class SnapshotSlot
+    {
+    private:
+        // **** declare attributes ****
+        std::atomic<std::shared_ptr<const MagicalSnapshot>> current_; // null until the first store
+
+    public:
+        // **** declare & define constructors ****
+        SnapshotSlot() = default; // slot without a snapshot
+        SnapshotSlot(const SnapshotSlot &other): current_(other.load()) {} // slot sharing the snapshot of other
+        SnapshotSlot& operator=(const SnapshotSlot &other) {store(other.load()); return *this;} // share the snapshot of other
+
+        // **** declare & define functions ****
+        std::shared_ptr<const MagicalSnapshot> load() const {return current_.load(std::memory_order_acquire);} // return the snapshot, null before the first store
+        void store(std::shared_ptr<const MagicalSnapshot> snapshot) {current_.store(std::move(snapshot), std::memory_order_release);} // replace the snapshot, the old one lives on while readers hold it
+    };
+}
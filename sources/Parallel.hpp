@@ -0,0 +1,84 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ariel {
+    // how many threads a bulk operation may use
+    struct ExecutionPolicy
+    {
+        std::size_t threads = 1; // threads working at once, the calling thread is one of them
+    };
+
+    // run body(part, begin, end) for parts equal slices of [0, n), every slice on its own thread. the calling thread
+    // runs the first slice and returns when every slice is done
+    template <class Body>
+    void parallelFor(std::size_t parts, std::size_t n, Body body)
+    {
+        parts = std::max<std::size_t>(parts, 1);
+        std::vector<std::thread> workers;
+        workers.reserve(parts - 1);
+        for (std::size_t part = 1; part < parts; ++part)
+        {
+            workers.emplace_back([&body, part, parts, n] {body(part, n * part / parts, n * (part + 1) / parts);});
+        }
+        body(0, 0, n / parts);
+        for (auto &worker : workers) worker.join();
+    }
+
+    // number of elements the first k outputs of a stable merge of sorted a and b take from a
+    template <class Value>
+    std::size_t mergeSplit(const Value *a, std::size_t a_size, const Value *b, std::size_t b_size, std::size_t k)
+    {
+        std::size_t low = k > b_size ? k - b_size : 0;
+        std::size_t high = std::min(k, a_size);
+        while (low < high)
+        {
+            std::size_t middle = (low + high) / 2;
+            if (a[middle] <= b[k - middle - 1]) low = middle + 1; // equal elements of a go first
+            else high = middle;
+        }
+        return low;
+    }
+
+    // sort values with threads threads: every thread sorts one slice, then the sorted runs are merged pairwise. every
+    // merge round splits its output in equal slices by binary search, so all threads work in every round
+    template <class Value>
+    void parallelSort(std::vector<Value> &values, std::size_t threads)
+    {
+        threads = std::max<std::size_t>(std::min(threads, values.size() / 2), 1);
+        std::size_t n = values.size();
+        parallelFor(threads, n, [&](std::size_t, std::size_t begin, std::size_t end) {std::sort(values.begin() + static_cast<std::ptrdiff_t>(begin), values.begin() + static_cast<std::ptrdiff_t>(end));});
+        if (threads == 1) return;
+
+        std::vector<Value> buffer(n);
+        Value *source = values.data();
+        Value *target = buffer.data();
+        auto bound = [&](std::size_t run) {return n * std::min(run, threads) / threads;};
+        for (std::size_t width = 1; width < threads; width *= 2)
+        {
+            parallelFor(threads, n, [&](std::size_t, std::size_t low, std::size_t high) {
+                for (std::size_t run = 0; run < threads; run += 2 * width)
+                {
+                    std::size_t first = bound(run);
+                    std::size_t middle = bound(run + width);
+                    std::size_t last = bound(run + 2 * width);
+                    if (std::max(low, first) >= std::min(high, last)) continue; // this pair is outside the slice
+
+                    // merge the outputs of the pair that fall in [low, high)
+                    std::size_t k_begin = std::max(low, first) - first;
+                    std::size_t k_end = std::min(high, last) - first;
+                    const Value *a = source + first;
+                    const Value *b = source + middle;
+                    std::size_t i_begin = mergeSplit(a, middle - first, b, last - middle, k_begin);
+                    std::size_t i_end = mergeSplit(a, middle - first, b, last - middle, k_end);
+                    std::merge(a + i_begin, a + i_end, b + (k_begin - i_begin), b + (k_end - i_end), target + first + k_begin);
+                }
+            });
+            std::swap(source, target);
+        }
+        if (source != values.data()) values.swap(buffer);
+    }
+}
@@ -0,0 +1,169 @@
+#include "PrimeSieve.hpp"
+#include <algorithm>
+namespace ariel
+{
+    namespace
+    {
+        constexpr std::uint32_t MIN_LIMIT = 1U << 16; // first sieve covers every base prime a 32 bit value needs
+        constexpr std::uint32_t SEGMENT_SIZE = 1U << 19; // values sieved per segment, half a bit per value fits in L1
+
+        bool testBit(const std::vector<std::uint64_t> &bits, std::uint64_t index) {return ((bits[index >> 6] >> (index & 63)) & 1U) != 0;}
+        void setBit(std::vector<std::uint64_t> &bits, std::uint64_t index) {bits[index >> 6] |= std::uint64_t{1} << (index & 63);}
+
+        // (base^exponent) % modulus without overflow for 32 bit modulus
+        std::uint64_t powMod(std::uint64_t base, std::uint64_t exponent, std::uint64_t modulus)
+        {
+            std::uint64_t result = 1;
+            base %= modulus;
+            while (exponent > 0)
+            {
+                if ((exponent & 1U) != 0) result = result * base % modulus;
+                base = base * base % modulus;
+                exponent >>= 1U;
+            }
+            return result;
+        }
+    }
+
+//----------- PrimeSieve class ---------------------------------------
+    // **** define constructors ****
+    /**
+     * @brief constructor, no memory is used until the first lookup
+     * @param ceiling largest value answered by the sieve, larger values use Miller-Rabin
+     */
+    PrimeSieve::PrimeSieve(std::uint32_t ceiling): ceiling_(std::max(ceiling, MIN_LIMIT)), limit_(0) {}
+
+    // **** define function ****
+    /**
+     * @brief grow the sieve to cover value. the covered range at least doubles so growth is amortized
+     * @param value value that must be covered, at most the ceiling
+     */
+    void PrimeSieve::growTo_(std::uint32_t value)
+    {
+        if (value < limit_) return; // already covered
+
+        std::uint64_t target = std::max<std::uint64_t>({std::uint64_t{value} + 1, std::uint64_t{limit_} * 2, MIN_LIMIT});
+        target = std::min<std::uint64_t>(target, std::uint64_t{ceiling_} + 1);
+        target = (target + 127) & ~std::uint64_t{127}; // whole words of odd numbers
+        composite_.resize(static_cast<std::size_t>(target / 128), 0);
+
+        std::uint64_t low = limit_;
+        if (low == 0) // first segment holds its own base primes, sieve it directly
+        {
+            setBit(composite_, 0); // 1 is not prime
+            for (std::uint64_t p = 3; p * p < MIN_LIMIT; p += 2)
+            {
+                if (testBit(composite_, p >> 1)) continue;
+                for (std::uint64_t m = p * p; m < MIN_LIMIT; m += 2 * p) setBit(composite_, m >> 1);
+            }
+            low = MIN_LIMIT;
+        }
+
+        // sieve the new range segment by segment with the base primes already known
+        for (; low < target; low += SEGMENT_SIZE)
+        {
+            std::uint64_t high = std::min<std::uint64_t>(low + SEGMENT_SIZE, target);
+            for (std::uint64_t p = 3; p * p < high; p += 2)
+            {
+                if (testBit(composite_, p >> 1)) continue;
+                std::uint64_t start = std::max(p * p, (low + p - 1) / p * p);
+                if ((start & 1U) == 0) start += p; // only odd multiples are stored
+                for (std::uint64_t m = start; m < high; m += 2 * p) setBit(composite_, m >> 1);
+            }
+        }
+        limit_ = static_cast<std::uint32_t>(std::min<std::uint64_t>(target, UINT32_MAX));
+    }
+
+    /**
+     * @brief Miller-Rabin with bases 2, 7, 61, exact for every 32 bit value
+     * @param value odd value bigger than 61
+     * @return bool that indicated if value is prime
+     */
+    bool PrimeSieve::millerRabin_(std::uint32_t value)
+    {
+        std::uint64_t odd = value - 1;
+        unsigned shifts = 0;
+        while ((odd & 1U) == 0)
+        {
+            odd >>= 1U;
+            ++shifts;
+        }
+        for (std::uint64_t base : {2U, 7U, 61U})
+        {
+            std::uint64_t x = powMod(base, odd, value);
+            if (x == 1 || x == value - 1) continue;
+            bool witness = true;
+            for (unsigned i = 1; i < shifts && witness; ++i)
+            {
+                x = x * x % value;
+                if (x == value - 1) witness = false;
+            }
+            if (witness) return false; // base proves value composite
+        }
+        return true;
+    }
+
+    /**
+     * @brief function check for prime numbers
+     * @param element number
+     * @return bool that indicated if number is prime
+     */
+    bool PrimeSieve::isPrime(int element)
+    {
+        if (element < 2) return false; // non prime
+        if (element == 2) return true; // prime
+        auto value = static_cast<std::uint32_t>(element);
+        if ((value & 1U) == 0) return false; // even, non prime
+        if (value > ceiling_) return millerRabin_(value);
+
+        growTo_(value);
+        return !testBit(composite_, value >> 1);
+    }
+
+    /**
+     * @brief grow the sieve once so isPrime and lookup answer every value up to element without growing. values
+     * above the ceiling go to Miller-Rabin, so pass the largest element at or below the ceiling
+     * @param element largest element up to the ceiling that will be looked up, larger elements do not grow the sieve
+     */
+    void PrimeSieve::cover(int element)
+    {
+        if (element > 2 && static_cast<std::uint32_t>(element) <= ceiling_) growTo_(static_cast<std::uint32_t>(element));
+    }
+
+    /**
+     * @brief check for prime numbers without growing the sieve, so many threads may look up at once
+     * @param element number, covered by the sieve or above the ceiling
+     * @return bool that indicated if number is prime
+     */
+    bool PrimeSieve::lookup(int element) const
+    {
+        if (element < 2) return false; // non prime
+        if (element == 2) return true; // prime
+        auto value = static_cast<std::uint32_t>(element);
+        if ((value & 1U) == 0) return false; // even, non prime
+        if (value > ceiling_) return millerRabin_(value);
+        return !testBit(composite_, value >> 1);
+    }
+
+    /**
+     * @brief classify a batch of elements, the sieve grows once for the largest element it answers. elements above
+     * the ceiling are tested with Miller-Rabin and never grow it
+     * @param elements elements to classify
+     * @param flags resized to elements size, flags[i] set when elements[i] is prime
+     */
+    void PrimeSieve::classify(std::span<const int> elements, std::vector<bool> &flags)
+    {
+        flags.assign(elements.size(), false);
+        int max_element = 0;
+        for (int element : elements)
+        {
+            if (static_cast<std::int64_t>(element) <= static_cast<std::int64_t>(ceiling_)) max_element = std::max(max_element, element);
+        }
+        cover(max_element);
+
+        for (std::size_t i = 0; i < elements.size(); ++i)
+        {
+            flags[i] = lookup(elements[i]);
+        }
+    }
+}
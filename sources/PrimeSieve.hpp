@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ariel {
+//----------- PrimeSieve class ---------------------------------------
+    class PrimeSieve
+    {
+    public:
+        static constexpr std::uint32_t DEFAULT_CEILING = 1U << 26; // largest value answered by the sieve by default
+
+    private:
+        // **** declare attributes ****
+        std::uint32_t ceiling_; // values above the ceiling are tested with Miller-Rabin
+        std::uint32_t limit_; // sieve covers every value below the limit
+        std::vector<std::uint64_t> composite_; // bit i set when odd number 2i+1 is composite
+
+        void growTo_(std::uint32_t value); // extend the sieve segment by segment to cover value
+        static bool millerRabin_(std::uint32_t value); // deterministic primality test for 32 bit values
+
+    public:
+        // **** declare constructors ****
+        explicit PrimeSieve(std::uint32_t ceiling = DEFAULT_CEILING); // sieve that grows lazily up to ceiling
+
+        // **** declare & define getters ****
+        std::uint32_t ceiling() const {return ceiling_;} // return the sieve ceiling
+        std::uint32_t limit() const {return limit_;} // return the value the sieve currently covers up to
+
+        // **** declare functions ****
+        bool isPrime(int element); // check if element is prime
+        void cover(int element); // grow the sieve so every value up to element is answered without growing, elements above the ceiling do not grow it
+        bool lookup(int element) const; // check if element is prime without growing, element covered or above the ceiling. safe from many threads
+        void classify(std::span<const int> elements, std::vector<bool> &flags); // flags[i] set when elements[i] is prime
+    };
+}
@@ -0,0 +1,221 @@
+#include "RankSelect.hpp"
+#include <algorithm>
+#include <bit>
+#include <utility>
+namespace ariel
+{
+    namespace
+    {
+        // position of the set bit of rank k inside word, k below the word popcount
+        std::size_t selectInWord(std::uint64_t word, std::size_t k)
+        {
+            for (; k > 0; --k) word &= word - 1; // drop the k lowest set bits
+            return static_cast<std::size_t>(std::countr_zero(word));
+        }
+
+        // mask of the bits below offset
+        std::uint64_t lowMask(std::size_t offset) {return (std::uint64_t{1} << offset) - 1;}
+    }
+
+//----------- RankSelect class ---------------------------------------
+    // **** define function ****
+    /**
+     * @brief recompute the block ranks from block to the end and the select samples that point at block or later.
+     * ranks and samples before block are unchanged by an edit inside block
+     * @param block first block whose bits changed
+     */
+    void RankSelect::rebuildFrom_(std::size_t block)
+    {
+        std::size_t blocks = (words_.size() + BLOCK_WORDS - 1) / BLOCK_WORDS;
+        block_ranks_.resize(blocks + 1, 0);
+        block = std::min(block, blocks);
+        while (!select_samples_.empty() && select_samples_.back() >= block) select_samples_.pop_back();
+
+        for (std::size_t b = block; b < blocks; ++b)
+        {
+            std::uint32_t ones = 0;
+            std::size_t last = std::min(words_.size(), (b + 1) * BLOCK_WORDS);
+            for (std::size_t w = b * BLOCK_WORDS; w < last; ++w) ones += static_cast<std::uint32_t>(std::popcount(words_[w]));
+            block_ranks_[b + 1] = block_ranks_[b] + ones;
+            while (select_samples_.size() * SAMPLE_RATE < block_ranks_[b + 1]) select_samples_.push_back(static_cast<std::uint32_t>(b));
+        }
+        ones_ = block_ranks_[blocks];
+    }
+
+    /**
+     * @brief memory held by the bit vector
+     * @return bytes of the bits, the block ranks and the select samples
+     */
+    std::size_t RankSelect::memoryBytes() const
+    {
+        return words_.capacity() * sizeof(std::uint64_t) + block_ranks_.capacity() * sizeof(std::uint32_t) + select_samples_.capacity() * sizeof(std::uint32_t);
+    }
+
+    /**
+     * @brief count the set bits before position: the block rank plus at most BLOCK_WORDS popcounts
+     * @param position bit position, at most size
+     * @return number of set bits in [0, position)
+     */
+    std::size_t RankSelect::rank(std::size_t position) const
+    {
+        std::size_t block = position / BLOCK_BITS;
+        std::size_t ones = block_ranks_[block];
+        std::size_t word = position >> 6U;
+        for (std::size_t w = block * BLOCK_WORDS; w < word; ++w) ones += static_cast<std::size_t>(std::popcount(words_[w]));
+        if ((position & 63U) != 0) ones += static_cast<std::size_t>(std::popcount(words_[word] & lowMask(position & 63U)));
+        return ones;
+    }
+
+    /**
+     * @brief find the set bit of rank k. the sample narrows the search to the blocks between two samples, a binary
+     * search finds the block and at most BLOCK_WORDS popcounts find the word
+     * @param k rank of the bit, below ones
+     * @return position of the bit
+     */
+    std::size_t RankSelect::select(std::size_t k) const
+    {
+        std::size_t sample = k / SAMPLE_RATE;
+        std::size_t low = select_samples_[sample];
+        std::size_t high = sample + 1 < select_samples_.size() ? select_samples_[sample + 1] + 1 : block_ranks_.size() - 1;
+        auto ranks = block_ranks_.begin();
+        auto block = static_cast<std::size_t>(std::upper_bound(ranks + static_cast<std::ptrdiff_t>(low), ranks + static_cast<std::ptrdiff_t>(high), k) - ranks) - 1;
+
+        std::size_t remaining = k - block_ranks_[block];
+        std::size_t word = block * BLOCK_WORDS;
+        for (auto ones = static_cast<std::size_t>(std::popcount(words_[word])); remaining >= ones; ones = static_cast<std::size_t>(std::popcount(words_[++word])))
+        {
+            remaining -= ones;
+        }
+        return (word << 6U) + selectInWord(words_[word], remaining);
+    }
+
+    /**
+     * @brief scan backward for a set bit
+     * @param position last position to look at
+     * @return last set bit at or before position, size if there is none
+     */
+    std::size_t RankSelect::prevOne(std::size_t position) const
+    {
+        if (size_ == 0) return size_;
+        position = std::min(position, size_ - 1);
+        std::size_t word = position >> 6U;
+        std::uint64_t bits = words_[word] & ((position & 63U) == 63 ? ~std::uint64_t{0} : lowMask((position & 63U) + 1));
+        while (bits == 0)
+        {
+            if (word == 0) return size_;
+            bits = words_[--word];
+        }
+        return (word << 6U) + 63 - static_cast<std::size_t>(std::countl_zero(bits));
+    }
+
+    /**
+     * @brief insert a bit, every later word is shifted by one bit and the indexes are updated from its block on
+     * @param position position of the new bit, at most size
+     * @param bit value of the new bit
+     */
+    void RankSelect::insert(std::size_t position, bool bit)
+    {
+        if ((size_ & 63U) == 0) words_.push_back(0);
+        ++size_;
+
+        std::size_t word = position >> 6U;
+        std::size_t offset = position & 63U;
+        std::uint64_t carry = words_[word] >> 63U;
+        std::uint64_t low = words_[word] & lowMask(offset);
+        std::uint64_t high = (words_[word] & ~lowMask(offset)) << 1U;
+        words_[word] = low | high | (std::uint64_t{bit} << offset);
+        for (std::size_t w = word + 1; w < words_.size(); ++w)
+        {
+            std::uint64_t next_carry = words_[w] >> 63U;
+            words_[w] = (words_[w] << 1U) | carry;
+            carry = next_carry;
+        }
+        rebuildFrom_(position / BLOCK_BITS);
+    }
+
+    /**
+     * @brief erase a bit, every later word is shifted back by one bit and the indexes are updated from its block on
+     * @param position position of the bit, below size
+     */
+    void RankSelect::erase(std::size_t position)
+    {
+        std::size_t word = position >> 6U;
+        std::size_t offset = position & 63U;
+        std::uint64_t low = words_[word] & lowMask(offset);
+        std::uint64_t high = offset == 63 ? 0 : (words_[word] >> (offset + 1)) << offset;
+        words_[word] = low | high;
+        for (std::size_t w = word + 1; w < words_.size(); ++w)
+        {
+            words_[w - 1] |= (words_[w] & 1U) << 63U;
+            words_[w] >>= 1U;
+        }
+
+        --size_;
+        if ((size_ & 63U) == 0) words_.pop_back(); // the last word only held the shifted out bit
+        rebuildFrom_(position / BLOCK_BITS);
+    }
+
+    /**
+     * @brief overwrite a bit without updating the indexes, call build when done
+     * @param position position of the bit, below size
+     * @param bit new value
+     */
+    void RankSelect::set(std::size_t position, bool bit)
+    {
+        std::uint64_t mask = std::uint64_t{1} << (position & 63U);
+        if (bit) words_[position >> 6U] |= mask;
+        else words_[position >> 6U] &= ~mask;
+    }
+
+    /**
+     * @brief append a bit without updating the indexes, call build when done
+     * @param bit value of the new bit
+     */
+    void RankSelect::pushBack(bool bit)
+    {
+        if ((size_ & 63U) == 0) words_.push_back(0);
+        set(size_++, bit);
+    }
+
+    /**
+     * @brief change the number of bits without updating the indexes, call build when done
+     * @param size new number of bits, new bits are clear
+     */
+    void RankSelect::resize(std::size_t size)
+    {
+        words_.resize((size + 63) / 64, 0);
+        if (size < size_ && (size & 63U) != 0) words_.back() &= lowMask(size & 63U); // keep bits past size clear
+        size_ = size;
+    }
+
+    /**
+     * @brief reserve the words for size bits so appending does not reallocate
+     * @param size number of bits
+     */
+    void RankSelect::reserve(std::size_t size)
+    {
+        words_.reserve((size + 63) / 64);
+    }
+
+    /**
+     * @brief replace the bits with words filled elsewhere, without updating the indexes, call build when done
+     * @param words bit i is bit i % 64 of word i / 64, at least size bits, bits past size clear
+     * @param size number of bits
+     */
+    void RankSelect::assign(std::vector<std::uint64_t> words, std::size_t size)
+    {
+        words_ = std::move(words);
+        words_.resize((size + 63) / 64, 0);
+        size_ = size;
+    }
+
+    /**
+     * @brief recompute the block ranks and the select samples of the whole vector
+     */
+    void RankSelect::build()
+    {
+        block_ranks_.assign(1, 0);
+        select_samples_.clear();
+        rebuildFrom_(0);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ariel {
+//----------- RankSelect class ---------------------------------------
+    // bit vector with rank and select. every block of BLOCK_BITS bits stores the number of set bits before it and
+    // every SAMPLE_RATE-th set bit stores its block, so both queries read a few words only
+    class RankSelect
+    {
+    public:
+        static constexpr std::size_t BLOCK_WORDS = 8; // words per rank block
+        static constexpr std::size_t BLOCK_BITS = BLOCK_WORDS * 64; // bits per rank block
+        static constexpr std::size_t SAMPLE_RATE = 512; // set bits per select sample
+
+    private:
+        // **** declare attributes ****
+        std::vector<std::uint64_t> words_; // bit i is bit i % 64 of word i / 64, bits past size are clear
+        std::vector<std::uint32_t> block_ranks_; // set bits before every block, the extra last entry holds the total
+        std::vector<std::uint32_t> select_samples_; // block that holds the set bit of rank k * SAMPLE_RATE
+        std::size_t size_ = 0; // number of bits
+        std::size_t ones_ = 0; // number of set bits
+
+        void rebuildFrom_(std::size_t block); // recompute the block ranks from block on and the select samples after it
+
+    public:
+        // **** declare & define getters ****
+        std::size_t size() const {return size_;} // return the number of bits
+        std::size_t ones() const {return ones_;} // return the number of set bits
+        bool test(std::size_t position) const {return ((words_[position >> 6U] >> (position & 63U)) & 1U) != 0;} // return the bit at position
+        std::size_t memoryBytes() const; // return the bytes used by the bits and the indexes
+
+        // **** declare functions ****
+        std::size_t rank(std::size_t position) const; // return the number of set bits before position
+        std::size_t select(std::size_t k) const; // return the position of the set bit of rank k, k below ones
+        std::size_t nextOne(std::size_t position) const // return the first set bit at or after position, size if none
+        {
+            if (position >= size_) return size_;
+            std::size_t word = position >> 6U;
+            std::uint64_t bits = words_[word] & (~std::uint64_t{0} << (position & 63U));
+            while (bits == 0)
+            {
+                if (++word == words_.size()) return size_;
+                bits = words_[word];
+            }
+            return (word << 6U) + static_cast<std::size_t>(std::countr_zero(bits));
+        }
+        std::size_t prevOne(std::size_t position) const; // return the last set bit at or before position, size if none
+        void insert(std::size_t position, bool bit); // insert bit at position, later bits move up one position
+        void erase(std::size_t position); // erase the bit at position, later bits move down one position
+        void set(std::size_t position, bool bit); // overwrite the bit at position, indexes are stale until build
+        void pushBack(bool bit); // append a bit, indexes are stale until build
+        void resize(std::size_t size); // truncate or append clear bits, indexes are stale until build
+        void reserve(std::size_t size); // reserve room for size bits
+        void assign(std::vector<std::uint64_t> words, std::size_t size); // take size bits packed in words, indexes are stale until build
+        void build(); // recompute every index
+    };
+}
@@ -0,0 +1,57 @@
+#include "StagingRing.hpp"
+#include <bit>
+namespace ariel
+{
+//----------- StagingRing class ---------------------------------------
+    // **** define constructors ****
+    /**
+     * @brief constructor
+     * @param capacity slots wanted, rounded up to a power of two. a ring without slots rejects every push
+     */
+    StagingRing::StagingRing(std::size_t capacity): slots_(capacity == 0 ? 0 : std::bit_ceil(capacity)), mask_(slots_.empty() ? 0 : slots_.size() - 1) {}
+
+    /**
+     * @brief copy constructor, the staged elements are copied in push order
+     * @param other ring to copy, no thread may push to or drain it meanwhile
+     */
+    StagingRing::StagingRing(const StagingRing &other): StagingRing(other.capacity())
+    {
+        *this = other;
+    }
+
+    /**
+     * @brief copy assignment, the staged elements are copied in push order
+     * @param other ring to copy, no thread may push to or drain either ring meanwhile
+     * @return this ring
+     */
+    StagingRing& StagingRing::operator=(const StagingRing &other)
+    {
+        if (this == &other) return *this;
+        slots_.assign(other.slots_.size(), 0);
+        mask_ = other.mask_;
+        std::size_t head = other.head_.load(std::memory_order_acquire);
+        std::size_t tail = other.tail_.load(std::memory_order_acquire);
+        for (std::size_t counter = head; counter < tail; ++counter) slots_[counter - head] = other.slots_[counter & other.mask_];
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(tail - head, std::memory_order_release);
+        head_cache_ = 0;
+        return *this;
+    }
+
+    // **** define function ****
+    /**
+     * @brief move every staged element out in push order. the slots are released in one store, so the producer sees
+     * the whole batch freed at once
+     * @param out elements are appended here
+     * @return number of elements drained
+     */
+    std::size_t StagingRing::drain(std::vector<int> &out)
+    {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        std::size_t tail = tail_.load(std::memory_order_acquire);
+        out.reserve(out.size() + (tail - head));
+        for (std::size_t counter = head; counter < tail; ++counter) out.push_back(slots_[counter & mask_]);
+        head_.store(tail, std::memory_order_release);
+        return tail - head;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace ariel {
+//----------- StagingRing class ---------------------------------------
+    // lock free ring of elements between one producer thread and one consumer thread. the producer only writes the
+    // tail and the consumer only writes the head, so push and drain never wait on each other
+    class StagingRing
+    {
+    private:
+        // **** declare attributes ****
+        std::vector<int> slots_; // capacity slots, a power of two
+        std::size_t mask_ = 0; // capacity - 1, maps a counter to its slot
+        alignas(64) std::atomic<std::size_t> head_ = 0; // elements drained so far, written by the consumer
+        alignas(64) std::atomic<std::size_t> tail_ = 0; // elements pushed so far, written by the producer
+        std::size_t head_cache_ = 0; // producer copy of the head, refreshed only when the ring looks full
+
+    public:
+        // **** declare constructors ****
+        explicit StagingRing(std::size_t capacity = 0); // ring of at least capacity slots, no slots when capacity is 0
+        StagingRing(const StagingRing &other); // ring of the same capacity holding the elements other holds, no thread may use other meanwhile
+        StagingRing& operator=(const StagingRing &other); // take the capacity and the elements of other, no thread may use either ring meanwhile
+
+        // **** declare & define getters ****
+        std::size_t capacity() const {return slots_.size();} // return the number of slots
+        bool empty() const {return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);} // check if nothing is staged, from the consumer
+        std::size_t size() const {return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);} // return the number of staged elements, a snapshot from any thread
+
+        // **** declare & define functions ****
+        bool push(int element) // stage element in O(1), false when the ring is full. producer thread only
+        {
+            std::size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_cache_ == slots_.size())
+            {
+                head_cache_ = head_.load(std::memory_order_acquire);
+                if (tail - head_cache_ == slots_.size()) return false;
+            }
+            slots_[tail & mask_] = element;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+        std::size_t drain(std::vector<int> &out); // append every staged element to out in push order, return how many. consumer thread only
+    };
+}
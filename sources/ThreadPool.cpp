@@ -0,0 +1,127 @@
+#include "ThreadPool.hpp"
+namespace ariel
+{
+//----------- ThreadPool class ---------------------------------------
+    // **** define constructors ****
+    /**
+     * @brief constructor, starts threads - 1 workers that sleep until the first run
+     * @param threads number of threads, the calling thread of run included. zero counts as one
+     */
+    ThreadPool::ThreadPool(std::size_t threads)
+    {
+        threads = std::max<std::size_t>(threads, 1);
+        for (std::size_t queue = 0; queue < threads; ++queue) queues_.push_back(std::make_unique<Queue>());
+        workers_.reserve(threads - 1);
+        for (std::size_t queue = 1; queue < threads; ++queue) workers_.emplace_back([this, queue] {work_(queue);});
+    }
+
+    /**
+     * @brief destructor, wakes the workers, waits for them to leave and joins them
+     */
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::scoped_lock lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto &worker : workers_) worker.join();
+    }
+
+    // **** define function ****
+    /**
+     * @brief run one task: the newest task of queue, or else the oldest task of the first other queue that has one
+     * @param queue queue of the calling thread
+     * @return false if every queue was empty
+     */
+    bool ThreadPool::runOne_(std::size_t queue)
+    {
+        std::size_t task = 0;
+        bool found = false;
+        for (std::size_t offset = 0; offset < queues_.size() && !found; ++offset)
+        {
+            Queue &victim = *queues_[(queue + offset) % queues_.size()];
+            std::scoped_lock lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            if (offset == 0)
+            {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+            }
+            else
+            {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+            }
+            found = true;
+        }
+        if (!found) return false;
+
+        try
+        {
+            (*task_)(task);
+        }
+        catch (...)
+        {
+            std::scoped_lock lock(mutex_);
+            if (!error_) error_ = std::current_exception();
+        }
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::scoped_lock lock(mutex_);
+            done_.notify_all();
+        }
+        return true;
+    }
+
+    /**
+     * @brief worker loop: sleep until a run starts, drain the queues, repeat until the pool stops
+     * @param queue queue owned by the worker
+     */
+    void ThreadPool::work_(std::size_t queue)
+    {
+        std::size_t seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock lock(mutex_);
+                wake_.wait(lock, [&] {return stop_ || generation_ != seen;});
+                if (stop_) return;
+                seen = generation_;
+            }
+            while (runOne_(queue)) {}
+        }
+    }
+
+    /**
+     * @brief run numbered tasks on every thread and wait for them. every queue starts with one contiguous block of
+     * task numbers, so neighbouring tasks stay on one thread unless they are stolen. a run that starts while
+     * another is in flight waits for it, and a task that calls run on its own pool deadlocks
+     * @param tasks number of tasks
+     * @param task called once with every number in [0, tasks), from any thread of the pool
+     */
+    void ThreadPool::run(std::size_t tasks, const std::function<void(std::size_t)> &task)
+    {
+        if (tasks == 0) return;
+        std::scoped_lock run_lock(run_mutex_);
+        {
+            std::scoped_lock lock(mutex_);
+            task_ = &task;
+            error_ = nullptr;
+            remaining_ = tasks;
+            for (std::size_t queue = 0; queue < queues_.size(); ++queue)
+            {
+                std::scoped_lock queue_lock(queues_[queue]->mutex);
+                for (std::size_t number = tasks * queue / queues_.size(); number < tasks * (queue + 1) / queues_.size(); ++number) queues_[queue]->tasks.push_back(number);
+            }
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        while (runOne_(0)) {}
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [&] {return remaining_.load(std::memory_order_acquire) == 0;});
+        task_ = nullptr;
+        if (error_) std::rethrow_exception(error_);
+    }
+}
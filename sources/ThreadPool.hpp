@@ -0,0 +1,123 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace ariel {
+//----------- ThreadPool class ---------------------------------------
+    // fixed set of threads that run numbered tasks. every thread owns a queue of task numbers, takes work from its own
+    // back and steals from the front of the other queues when its own runs dry, so uneven tasks still keep every
+    // thread busy. the calling thread of run works as one of the threads
+    class ThreadPool
+    {
+    private:
+        // task numbers owned by one thread
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<std::size_t> tasks;
+        };
+
+        // **** declare attributes ****
+        std::vector<std::unique_ptr<Queue>> queues_; // queue 0 belongs to the calling thread of run
+        std::vector<std::thread> workers_; // worker i drains queue i + 1
+        std::mutex run_mutex_; // held for a whole run, so runs from several threads take turns
+        std::mutex mutex_; // guards the fields below
+        std::condition_variable wake_; // workers wait here for the next run
+        std::condition_variable done_; // run waits here for the last task
+        const std::function<void(std::size_t)>* task_ = nullptr; // task of the current run
+        std::size_t generation_ = 0; // number of runs started
+        std::atomic<std::size_t> remaining_ = 0; // tasks of the current run not finished yet
+        std::exception_ptr error_; // first exception thrown by a task of the current run
+        bool stop_ = false; // set when the pool is destroyed
+
+        bool runOne_(std::size_t queue); // run one task from queue or stolen from another queue, false when every queue is empty
+        void work_(std::size_t queue); // worker loop of the thread that owns queue
+
+    public:
+        // **** declare constructors ****
+        explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency()); // pool of threads threads, the calling thread included
+        ThreadPool(const ThreadPool &other) = delete; // the threads are not copyable
+        ThreadPool& operator=(const ThreadPool &other) = delete; // the threads are not copyable
+        ~ThreadPool(); // stop and join the workers
+
+        // **** declare & define getters ****
+        std::size_t threadCount() const {return queues_.size();} // return the number of threads, the calling thread included
+
+        // **** declare functions ****
+        void run(std::size_t tasks, const std::function<void(std::size_t)> &task); // run task(0) .. task(tasks - 1) and wait for all of them, rethrow the first exception. concurrent calls run one after the other, a task must not call run of its own pool
+    };
+
+    inline constexpr std::size_t CHUNKS_PER_THREAD = 8; // parallel traversals split an order in this many chunks per thread so stealing can even out the load
+    inline constexpr std::size_t TRAVERSAL_BATCH = 1024; // elements copied per nextBatch call of a parallel traversal
+
+    // cut an order in parts disjoint subranges. done on the calling thread, since making iterators merges the staged
+    // elements of the container and only one thread may do that
+    template <class View>
+    auto splitParts(const View &view, std::size_t parts)
+    {
+        std::vector<decltype(view.part(0, 1))> ranges;
+        ranges.reserve(parts);
+        for (std::size_t part = 0; part < parts; ++part) ranges.push_back(view.part(part, parts));
+        return ranges;
+    }
+
+    // call visit(element) for the elements of one part of an order, through the contiguous elements or nextBatch
+    template <class Range, class Visitor>
+    void visitPart(const Range &range, Visitor &visit)
+    {
+        auto first = range.begin();
+        auto count = static_cast<std::size_t>(range.end() - first);
+        if constexpr (std::contiguous_iterator<decltype(first)>)
+        {
+            for (int element : std::span<const int>(std::to_address(first), count)) visit(element);
+        }
+        else
+        {
+            std::array<int, TRAVERSAL_BATCH> buffer{};
+            while (count > 0)
+            {
+                std::size_t written = first.nextBatch(std::span<int>(buffer).first(std::min(count, buffer.size())));
+                for (std::size_t i = 0; i < written; ++i) visit(buffer[i]);
+                count -= written;
+            }
+        }
+    }
+
+    // call function(element) for every element of an order, on every thread of pool. the order is cut in chunks by
+    // part, the side cross parts map their positions to the two ascending index runs they cover
+    template <class View, class Function>
+    void parallelForEach(ThreadPool &pool, const View &view, Function function)
+    {
+        auto ranges = splitParts(view, pool.threadCount() * CHUNKS_PER_THREAD);
+        pool.run(ranges.size(), [&](std::size_t chunk) {visitPart(ranges[chunk], function);});
+    }
+
+    // fold every element of an order with fold(value, element) on every thread of pool, starting every chunk from
+    // identity, then combine the chunk results in order with combine(value, value)
+    template <class View, class Value, class Fold, class Combine>
+    Value parallelReduce(ThreadPool &pool, const View &view, Value identity, Fold fold, Combine combine)
+    {
+        auto ranges = splitParts(view, pool.threadCount() * CHUNKS_PER_THREAD);
+        std::vector<Value> partials(ranges.size(), identity);
+        pool.run(ranges.size(), [&](std::size_t chunk) {
+            Value value = identity;
+            auto visit = [&](int element) {value = fold(std::move(value), element);};
+            visitPart(ranges[chunk], visit);
+            partials[chunk] = std::move(value);
+        });
+        Value result = std::move(identity);
+        for (Value &partial : partials) result = combine(std::move(result), std::move(partial));
+        return result;
+    }
+}